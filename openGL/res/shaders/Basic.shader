@@ -11,7 +11,11 @@ void main()
 
 layout(location = 0) out vec4 color;
 
-uniform vec4 u_Color;
+//per-frame values, filled from a UniformBuffer
+layout(std140) uniform Frame
+{
+  vec4 u_Color;
+};
 
 void main()
 {
@@ -0,0 +1,62 @@
+#shader vertex
+#version 330 core
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float texIndex;
+
+uniform mat4 u_ViewProjection;
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+flat out int v_TexIndex;
+
+void main()
+{
+    gl_Position = u_ViewProjection * vec4(position, 0.0, 1.0);
+    v_TexCoord = texCoord;
+    v_Color = color;
+    v_TexIndex = int(texIndex + 0.5);
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+in vec4 v_Color;
+flat in int v_TexIndex;
+
+//must match BatchRenderer2D::MAX_TEXTURES
+uniform sampler2D u_Textures[16];
+
+//sampler arrays may only be indexed with constants in 330, so pick the slot with a switch
+vec4 SampleTexture()
+{
+    switch(v_TexIndex)
+    {
+        case 0: return texture(u_Textures[0], v_TexCoord);
+        case 1: return texture(u_Textures[1], v_TexCoord);
+        case 2: return texture(u_Textures[2], v_TexCoord);
+        case 3: return texture(u_Textures[3], v_TexCoord);
+        case 4: return texture(u_Textures[4], v_TexCoord);
+        case 5: return texture(u_Textures[5], v_TexCoord);
+        case 6: return texture(u_Textures[6], v_TexCoord);
+        case 7: return texture(u_Textures[7], v_TexCoord);
+        case 8: return texture(u_Textures[8], v_TexCoord);
+        case 9: return texture(u_Textures[9], v_TexCoord);
+        case 10: return texture(u_Textures[10], v_TexCoord);
+        case 11: return texture(u_Textures[11], v_TexCoord);
+        case 12: return texture(u_Textures[12], v_TexCoord);
+        case 13: return texture(u_Textures[13], v_TexCoord);
+        case 14: return texture(u_Textures[14], v_TexCoord);
+        case 15: return texture(u_Textures[15], v_TexCoord);
+    }
+    return vec4(1.0);
+}
+
+void main()
+{
+    color = SampleTexture() * v_Color;
+};
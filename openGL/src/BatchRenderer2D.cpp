@@ -0,0 +1,126 @@
+#include "BatchRenderer2D.h"
+#include "Renderer.h"
+
+//0, 1, 2, 2, 3, 0 for every quad, built once since it never changes
+static std::vector<unsigned int> BuildQuadIndices(unsigned int maxQuads)
+{
+  std::vector<unsigned int> indices((size_t)maxQuads * 6);
+  for(unsigned int q = 0; q < maxQuads; q++)
+  {
+    const unsigned int v = q * 4;
+    unsigned int* i = &indices[(size_t)q * 6];
+    i[0] = v; i[1] = v + 1; i[2] = v + 2;
+    i[3] = v + 2; i[4] = v + 3; i[5] = v;
+  }
+  return indices;
+}
+
+BatchRenderer2D::BatchRenderer2D(unsigned int maxQuads, const std::string& shaderPath)
+  : m_MaxQuads(maxQuads), m_Vertices((size_t)maxQuads * 4), m_QuadCount(0),
+    m_VertexBuffer(maxQuads * 4 * sizeof(QuadVertex)),
+    m_IndexBuffer(BuildQuadIndices(maxQuads).data(), maxQuads * 6),
+    m_Shader(shaderPath), m_TextureCount(1), m_DrawCount(0)
+{
+  //position, texture coordinates, color, texture slot
+  typedef Layout<Attr<float, 2>, Attr<float, 2>, Attr<unsigned char, 4, Normalized>, Attr<float, 1>> QuadLayout;
+  static_assert(QuadLayout::Stride == sizeof(QuadVertex), "QuadLayout doesn't match QuadVertex");
+  m_VertexArray.AddBuffer(m_VertexBuffer, QuadLayout());
+  m_IndexBuffer.Bind(); //stays attached to the vertex array
+  m_VertexArray.UnBind();
+
+  int units = 0;
+  GLCALL(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units));
+  m_TextureSlots = units > 0 && (unsigned int)units < MAX_TEXTURES ? units : MAX_TEXTURES;
+
+  const unsigned int white = 0xffffffff;
+  GLCALL(glGenTextures(1, &m_WhiteTexture));
+  GLCALL(glBindTexture(GL_TEXTURE_2D, m_WhiteTexture));
+  GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+  GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white));
+  GLCALL(glBindTexture(GL_TEXTURE_2D, 0));
+  m_Textures[0] = m_WhiteTexture;
+}
+
+BatchRenderer2D::~BatchRenderer2D()
+{
+  GLCALL(glDeleteTextures(1, &m_WhiteTexture));
+}
+
+void BatchRenderer2D::Begin(const float* viewProjection)
+{
+  m_QuadCount = 0;
+  m_TextureCount = 1;
+  m_DrawCount = 0;
+
+  int slots[MAX_TEXTURES];
+  for(unsigned int i = 0; i < MAX_TEXTURES; i++)
+    slots[i] = i;
+  //both are cached by the shader, so after the first frame they cost nothing
+  m_Shader.Bind();
+  m_Shader.SetUniformMat4f("u_ViewProjection", viewProjection);
+  m_Shader.SetUniform1iv("u_Textures", m_TextureSlots, slots);
+}
+
+unsigned int BatchRenderer2D::GetTextureSlot(unsigned int texture)
+{
+  for(unsigned int i = 0; i < m_TextureCount; i++)
+  {
+    if(m_Textures[i] == texture)
+      return i;
+  }
+  if(m_TextureCount == m_TextureSlots)
+    Flush();
+  m_Textures[m_TextureCount] = texture;
+  return m_TextureCount++;
+}
+
+void BatchRenderer2D::DrawQuad(float x, float y, float width, float height, unsigned int color)
+{
+  DrawQuad(x, y, width, height, m_WhiteTexture, nullptr, color);
+}
+
+void BatchRenderer2D::DrawQuad(float x, float y, float width, float height, unsigned int texture,
+  const float* uv, unsigned int color)
+{
+  if(m_QuadCount == m_MaxQuads)
+    Flush();
+  //after a flush caused by the texture slots the quad still fits
+  const float slot = (float)GetTextureSlot(texture);
+
+  static const float fullUv[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+  if(!uv)
+    uv = fullUv;
+
+  QuadVertex* v = &m_Vertices[(size_t)m_QuadCount * 4];
+  const float x1 = x + width, y1 = y + height;
+  v[0] = { { x,  y  }, { uv[0], uv[1] }, color, slot };
+  v[1] = { { x1, y  }, { uv[2], uv[1] }, color, slot };
+  v[2] = { { x1, y1 }, { uv[2], uv[3] }, color, slot };
+  v[3] = { { x,  y1 }, { uv[0], uv[3] }, color, slot };
+  m_QuadCount++;
+}
+
+void BatchRenderer2D::End()
+{
+  Flush();
+}
+
+void BatchRenderer2D::Flush()
+{
+  if(m_QuadCount > 0)
+  {
+    m_VertexBuffer.SetData(m_Vertices.data(), m_QuadCount * 4 * sizeof(QuadVertex));
+    for(unsigned int i = 0; i < m_TextureCount; i++)
+    {
+      GLCALL(glActiveTexture(GL_TEXTURE0 + i));
+      GLCALL(glBindTexture(GL_TEXTURE_2D, m_Textures[i]));
+    }
+    m_Shader.Bind();
+    m_VertexArray.Bind();
+    GLCALL(glDrawElements(GL_TRIANGLES, m_QuadCount * 6, GL_UNSIGNED_INT, nullptr));
+    m_DrawCount++;
+  }
+  m_QuadCount = 0;
+  m_TextureCount = 1;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "VertexArray.h"
+#include "Shader.h"
+
+//collects quads into one streaming vertex buffer and draws them with a static
+//index pattern. a batch is flushed only when the buffer is full or all texture
+//slots are taken, so thousands of sprites cost a handful of draw calls.
+//usage per frame: Begin, DrawQuad..., End
+class BatchRenderer2D
+{
+public:
+  //must match the u_Textures array in Batch.shader
+  static const unsigned int MAX_TEXTURES = 16;
+
+private:
+  struct QuadVertex
+  {
+    float position[2];
+    float texCoord[2];
+    unsigned int color;
+    float texIndex;
+  };
+
+  unsigned int m_MaxQuads;
+  std::vector<QuadVertex> m_Vertices;
+  unsigned int m_QuadCount;
+  VertexBuffer m_VertexBuffer;
+  IndexBuffer m_IndexBuffer;
+  VertexArray m_VertexArray;
+  Shader m_Shader;
+
+  //slot 0 always holds a 1x1 white texture for untextured quads
+  unsigned int m_WhiteTexture;
+  unsigned int m_Textures[MAX_TEXTURES];
+  unsigned int m_TextureCount;
+  unsigned int m_TextureSlots; //MAX_TEXTURES or fewer if the driver has less units
+
+  unsigned int m_DrawCount;
+
+  void Flush();
+  unsigned int GetTextureSlot(unsigned int texture);
+
+public:
+  BatchRenderer2D(unsigned int maxQuads = 10000, const std::string& shaderPath = "res/shaders/Batch.shader");
+  ~BatchRenderer2D();
+
+  BatchRenderer2D(const BatchRenderer2D&) = delete;
+  BatchRenderer2D& operator=(const BatchRenderer2D&) = delete;
+
+  //viewProjection is a column-major 4x4 matrix
+  void Begin(const float* viewProjection);
+  //color is packed RGBA8, red in the lowest byte (0xAABBGGRR)
+  void DrawQuad(float x, float y, float width, float height, unsigned int color);
+  //uv is u0, v0, u1, v1 of the sub-rectangle to show, nullptr for the whole texture
+  void DrawQuad(float x, float y, float width, float height, unsigned int texture,
+    const float* uv, unsigned int color = 0xffffffff);
+  //draws whatever is left
+  void End();
+
+  //draw calls issued since Begin
+  inline unsigned int GetDrawCount () const {return m_DrawCount;}
+};
@@ -0,0 +1,215 @@
+#include "CommandList.h"
+#include <algorithm>
+#include <cstring>
+#include "VertexArray.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "UniformBuffer.h"
+
+//payloads of the commands, they follow the header in the stream
+struct BindShaderCommand { Shader* shader; };
+struct BindVertexArrayCommand { const VertexArray* va; };
+struct BindIndexBufferCommand { const IndexBuffer* ib; };
+struct BindUniformRangeCommand { const UniformBuffer* buffer; unsigned int binding; UniformBlockRange range; };
+struct Uniform1iCommand { const char* name; int value; };
+struct Uniform1fCommand { const char* name; float value; };
+struct Uniform4fCommand { const char* name; float value[4]; };
+struct UniformMat4fCommand { const char* name; float value[16]; };
+struct DrawCommand { unsigned int instanceCount; unsigned int firstIndex; unsigned int indexCount; int baseVertex; };
+struct SubmitCommand { DrawPacket packet; };
+
+CommandList::CommandList(unsigned int order)
+  : m_Block(0), m_Order(order), m_CommandCount(0)
+{
+}
+
+void CommandList::Reset(unsigned int order)
+{
+  for(unsigned int i = 0; i < m_Used.size(); i++)
+    m_Used[i] = 0;
+  m_Block = 0;
+  m_Order = order;
+  m_CommandCount = 0;
+}
+
+void* CommandList::Allocate(CommandType type, unsigned int payloadSize)
+{
+  //8 byte steps keep every header and payload aligned for pointers and floats
+  const unsigned int size = (sizeof(CommandHeader) + payloadSize + 7) & ~7u;
+  ASSERT(size <= BLOCK_SIZE);
+  if(m_Blocks.empty() || m_Used[m_Block] + size > BLOCK_SIZE)
+  {
+    if(!m_Blocks.empty())
+      m_Block++;
+    if(m_Block == m_Blocks.size())
+    {
+      m_Blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[BLOCK_SIZE]));
+      m_Used.push_back(0);
+    }
+  }
+
+  unsigned char* command = m_Blocks[m_Block].get() + m_Used[m_Block];
+  m_Used[m_Block] += size;
+  m_CommandCount++;
+  CommandHeader* header = (CommandHeader*)command;
+  header->type = type;
+  header->size = size;
+  return command + sizeof(CommandHeader);
+}
+
+template<typename T>
+T* CommandList::RecordNamed(CommandType type, const char* name)
+{
+  const unsigned int length = (unsigned int)strlen(name) + 1;
+  T* command = (T*)Allocate(type, sizeof(T) + length);
+  char* copy = (char*)(command + 1);
+  memcpy(copy, name, length);
+  command->name = copy;
+  return command;
+}
+
+void CommandList::BindShader(Shader& shader)
+{
+  Record(CommandType::BIND_SHADER, BindShaderCommand{ &shader });
+}
+
+void CommandList::BindVertexArray(const VertexArray& va)
+{
+  Record(CommandType::BIND_VERTEX_ARRAY, BindVertexArrayCommand{ &va });
+}
+
+void CommandList::BindIndexBuffer(const IndexBuffer& ib)
+{
+  Record(CommandType::BIND_INDEX_BUFFER, BindIndexBufferCommand{ &ib });
+}
+
+void CommandList::BindUniformRange(const UniformBuffer& buffer, unsigned int binding, const UniformBlockRange& range)
+{
+  Record(CommandType::BIND_UNIFORM_RANGE, BindUniformRangeCommand{ &buffer, binding, range });
+}
+
+void CommandList::SetUniform1i(const char* name, int value)
+{
+  RecordNamed<Uniform1iCommand>(CommandType::SET_UNIFORM_1I, name)->value = value;
+}
+
+void CommandList::SetUniform1f(const char* name, float value)
+{
+  RecordNamed<Uniform1fCommand>(CommandType::SET_UNIFORM_1F, name)->value = value;
+}
+
+void CommandList::SetUniform4f(const char* name, float v0, float v1, float v2, float v3)
+{
+  Uniform4fCommand* command = RecordNamed<Uniform4fCommand>(CommandType::SET_UNIFORM_4F, name);
+  command->value[0] = v0;
+  command->value[1] = v1;
+  command->value[2] = v2;
+  command->value[3] = v3;
+}
+
+void CommandList::SetUniformMat4f(const char* name, const float* matrix)
+{
+  UniformMat4fCommand* command = RecordNamed<UniformMat4fCommand>(CommandType::SET_UNIFORM_MAT4F, name);
+  memcpy(command->value, matrix, sizeof(command->value));
+}
+
+void CommandList::Draw(unsigned int instanceCount, unsigned int firstIndex, unsigned int indexCount, int baseVertex)
+{
+  Record(CommandType::DRAW, DrawCommand{ instanceCount, firstIndex, indexCount, baseVertex });
+}
+
+void CommandList::Submit(const DrawPacket& packet)
+{
+  Record(CommandType::SUBMIT, SubmitCommand{ packet });
+}
+
+void CommandList::Execute(Renderer& renderer) const
+{
+  Shader* shader = nullptr;
+  const IndexBuffer* ib = nullptr;
+  for(unsigned int b = 0; b < m_Blocks.size() && m_Used[b] != 0; b++)
+  {
+    const unsigned char* command = m_Blocks[b].get();
+    const unsigned char* end = command + m_Used[b];
+    while(command < end)
+    {
+      const CommandHeader* header = (const CommandHeader*)command;
+      const void* payload = command + sizeof(CommandHeader);
+      switch(header->type)
+      {
+        case CommandType::BIND_SHADER:
+          shader = ((const BindShaderCommand*)payload)->shader;
+          shader->Bind();
+          break;
+        case CommandType::BIND_VERTEX_ARRAY:
+          ((const BindVertexArrayCommand*)payload)->va->Bind();
+          break;
+        case CommandType::BIND_INDEX_BUFFER:
+          ib = ((const BindIndexBufferCommand*)payload)->ib;
+          ib->Bind();
+          break;
+        case CommandType::BIND_UNIFORM_RANGE:
+        {
+          const BindUniformRangeCommand* bind = (const BindUniformRangeCommand*)payload;
+          bind->buffer->BindRange(bind->binding, bind->range);
+          break;
+        }
+        case CommandType::SET_UNIFORM_1I:
+        {
+          const Uniform1iCommand* uniform = (const Uniform1iCommand*)payload;
+          ASSERT(shader);
+          shader->SetUniform1i(uniform->name, uniform->value);
+          break;
+        }
+        case CommandType::SET_UNIFORM_1F:
+        {
+          const Uniform1fCommand* uniform = (const Uniform1fCommand*)payload;
+          ASSERT(shader);
+          shader->SetUniform1f(uniform->name, uniform->value);
+          break;
+        }
+        case CommandType::SET_UNIFORM_4F:
+        {
+          const Uniform4fCommand* uniform = (const Uniform4fCommand*)payload;
+          ASSERT(shader);
+          shader->SetUniform4f(uniform->name, uniform->value[0], uniform->value[1], uniform->value[2], uniform->value[3]);
+          break;
+        }
+        case CommandType::SET_UNIFORM_MAT4F:
+        {
+          const UniformMat4fCommand* uniform = (const UniformMat4fCommand*)payload;
+          ASSERT(shader);
+          shader->SetUniformMat4f(uniform->name, uniform->value);
+          break;
+        }
+        case CommandType::DRAW:
+        {
+          const DrawCommand* draw = (const DrawCommand*)payload;
+          ASSERT(ib);
+          const unsigned int count = draw->indexCount ? draw->indexCount : ib->GetCount();
+          //glew declares the BaseVertex offset non-const
+          void* offset = (void*)(draw->firstIndex * sizeof(unsigned int));
+          GLCALL(glDrawElementsInstancedBaseVertex(ib->GetTopology(), count, GL_UNSIGNED_INT, offset,
+            draw->instanceCount, draw->baseVertex));
+          break;
+        }
+        case CommandType::SUBMIT:
+          renderer.Submit(((const SubmitCommand*)payload)->packet);
+          break;
+      }
+      command += header->size;
+    }
+  }
+}
+
+void ExecuteCommandLists(const std::vector<CommandList*>& lists, Renderer& renderer)
+{
+  //completion order of the workers must not change the frame
+  std::vector<CommandList*> sorted(lists);
+  std::stable_sort(sorted.begin(), sorted.end(), [](const CommandList* a, const CommandList* b)
+  {
+    return a->GetOrder() < b->GetOrder();
+  });
+  for(unsigned int i = 0; i < sorted.size(); i++)
+    sorted[i]->Execute(renderer);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Renderer.h"
+
+enum class CommandType : unsigned int
+{
+  BIND_SHADER = 0,
+  BIND_VERTEX_ARRAY,
+  BIND_INDEX_BUFFER,
+  BIND_UNIFORM_RANGE,
+  SET_UNIFORM_1I,
+  SET_UNIFORM_1F,
+  SET_UNIFORM_4F,
+  SET_UNIFORM_MAT4F,
+  DRAW,
+  SUBMIT
+};
+
+//records draws, binds and uniform updates on any thread into a compact byte
+//stream, the render thread replays it with Execute. nothing touches GL while
+//recording, so every worker can fill its own list in parallel.
+//objects are stored by pointer and must live until execution, uniform names are copied.
+class CommandList
+{
+private:
+  struct CommandHeader
+  {
+    CommandType type;
+    unsigned int size; //header included, multiple of 8
+  };
+
+  //blocks are kept across Reset, so after the first frames recording never allocates
+  static const unsigned int BLOCK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<unsigned char[]>> m_Blocks;
+  std::vector<unsigned int> m_Used;
+  unsigned int m_Block;
+  unsigned int m_Order;
+  unsigned int m_CommandCount;
+
+  void* Allocate(CommandType type, unsigned int payloadSize);
+  template<typename T>
+  void Record(CommandType type, const T& payload)
+  {
+    *(T*)Allocate(type, sizeof(T)) = payload;
+  }
+  //the name is copied behind the payload, so it may be a temporary
+  template<typename T>
+  T* RecordNamed(CommandType type, const char* name);
+
+public:
+  //lists are executed in increasing order, whichever worker finished first
+  explicit CommandList(unsigned int order = 0);
+
+  CommandList(const CommandList&) = delete;
+  CommandList& operator=(const CommandList&) = delete;
+
+  //drops the recorded commands, keeps the memory
+  void Reset(unsigned int order);
+
+  void BindShader(Shader& shader);
+  void BindVertexArray(const VertexArray& va);
+  void BindIndexBuffer(const IndexBuffer& ib);
+  void BindUniformRange(const UniformBuffer& buffer, unsigned int binding, const UniformBlockRange& range);
+
+  //uniform setters apply to the shader of the last BindShader
+  void SetUniform1i(const char* name, int value);
+  void SetUniform1f(const char* name, float value);
+  void SetUniform4f(const char* name, float v0, float v1, float v2, float v3);
+  void SetUniformMat4f(const char* name, const float* matrix);
+
+  //draws the bound index buffer, indexCount 0 = all of it
+  void Draw(unsigned int instanceCount = 1, unsigned int firstIndex = 0, unsigned int indexCount = 0,
+    int baseVertex = 0);
+  //hands the packet to the renderer's sorted queue, Flush it after executing
+  void Submit(const DrawPacket& packet);
+
+  //replays the commands, has to run on the thread owning the GL context
+  void Execute(Renderer& renderer) const;
+
+  inline unsigned int GetOrder () const {return m_Order;}
+  inline unsigned int GetCommandCount () const {return m_CommandCount;}
+};
+
+//executes every list sorted by GetOrder(), ties keep their position in lists
+void ExecuteCommandLists(const std::vector<CommandList*>& lists, Renderer& renderer);
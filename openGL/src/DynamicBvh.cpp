@@ -0,0 +1,545 @@
+#include "DynamicBvh.h"
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include "Renderer.h"
+
+static Aabb Union(const Aabb& a, const Aabb& b)
+{
+  Aabb box;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    box.min[c] = a.min[c] < b.min[c] ? a.min[c] : b.min[c];
+    box.max[c] = a.max[c] > b.max[c] ? a.max[c] : b.max[c];
+  }
+  return box;
+}
+
+//half the surface area, only ever compared
+static float Area(const Aabb& box)
+{
+  const float x = box.max[0] - box.min[0];
+  const float y = box.max[1] - box.min[1];
+  const float z = box.max[2] - box.min[2];
+  return x * y + y * z + z * x;
+}
+
+static bool Contains(const Aabb& outer, const Aabb& inner)
+{
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    if(inner.min[c] < outer.min[c] || inner.max[c] > outer.max[c])
+      return false;
+  }
+  return true;
+}
+
+static bool Overlaps(const Aabb& a, const Aabb& b)
+{
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    if(a.max[c] < b.min[c] || a.min[c] > b.max[c])
+      return false;
+  }
+  return true;
+}
+
+//general 4x4 inverse by gauss-jordan elimination. inverting the transpose gives
+//the transposed inverse, so the storage order doesn't matter
+static bool Invert(const float* matrix, float* inverse)
+{
+  float a[4][8];
+  for(unsigned int r = 0; r < 4; r++)
+  {
+    for(unsigned int c = 0; c < 4; c++)
+    {
+      a[r][c] = matrix[r * 4 + c];
+      a[r][c + 4] = r == c ? 1.0f : 0.0f;
+    }
+  }
+  for(unsigned int c = 0; c < 4; c++)
+  {
+    unsigned int pivot = c;
+    for(unsigned int r = c + 1; r < 4; r++)
+    {
+      if(std::fabs(a[r][c]) > std::fabs(a[pivot][c]))
+        pivot = r;
+    }
+    if(a[pivot][c] == 0.0f)
+      return false;
+    for(unsigned int k = 0; k < 8; k++)
+    {
+      const float t = a[c][k];
+      a[c][k] = a[pivot][k];
+      a[pivot][k] = t;
+    }
+    const float scale = 1.0f / a[c][c];
+    for(unsigned int k = 0; k < 8; k++)
+      a[c][k] *= scale;
+    for(unsigned int r = 0; r < 4; r++)
+    {
+      if(r == c)
+        continue;
+      const float factor = a[r][c];
+      for(unsigned int k = 0; k < 8; k++)
+        a[r][k] -= factor * a[c][k];
+    }
+  }
+  for(unsigned int r = 0; r < 4; r++)
+  {
+    for(unsigned int c = 0; c < 4; c++)
+      inverse[r * 4 + c] = a[r][c + 4];
+  }
+  return true;
+}
+
+Ray Ray::FromScreen(const float* viewProjection, float x, float y)
+{
+  Ray ray = {};
+  float inverse[16];
+  if(!Invert(viewProjection, inverse))
+    return ray;
+
+  //unproject the point on the near (z = -1) and far (z = 1) plane
+  float points[2][3];
+  for(unsigned int p = 0; p < 2; p++)
+  {
+    const float ndc[4] = { x, y, p ? 1.0f : -1.0f, 1.0f };
+    float v[4];
+    for(unsigned int r = 0; r < 4; r++)
+      v[r] = inverse[r] * ndc[0] + inverse[4 + r] * ndc[1] + inverse[8 + r] * ndc[2] + inverse[12 + r] * ndc[3];
+    for(unsigned int c = 0; c < 3; c++)
+      points[p][c] = v[c] / v[3];
+  }
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    ray.origin[c] = points[0][c];
+    ray.direction[c] = points[1][c] - points[0][c];
+  }
+  return ray;
+}
+
+DynamicBvh::DynamicBvh(float margin)
+  : m_Root(NULL_NODE), m_FreeList(NULL_NODE), m_LeafCount(0), m_Margin(margin)
+{
+}
+
+int DynamicBvh::AllocateNode()
+{
+  if(m_FreeList == NULL_NODE)
+  {
+    m_Nodes.push_back(Node());
+    m_Links.push_back(NodeLinks());
+    m_Bounds.push_back(Aabb());
+    m_FreeList = (int)m_Nodes.size() - 1;
+    m_Links[m_FreeList].parent = NULL_NODE;
+  }
+  const int index = m_FreeList;
+  m_FreeList = m_Links[index].parent;
+  m_Nodes[index].child[0] = NULL_NODE;
+  m_Nodes[index].child[1] = NULL_NODE;
+  m_Links[index].parent = NULL_NODE;
+  m_Links[index].height = 0;
+  return index;
+}
+
+void DynamicBvh::FreeNode(int index)
+{
+  m_Links[index].parent = m_FreeList;
+  m_Links[index].height = -1;
+  m_FreeList = index;
+}
+
+int DynamicBvh::Insert(const Aabb& box, unsigned int userData)
+{
+  const int leaf = AllocateNode();
+  Aabb fat = box;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    fat.min[c] -= m_Margin;
+    fat.max[c] += m_Margin;
+  }
+  m_Nodes[leaf].box = fat;
+  m_Nodes[leaf].child[1] = (int)userData;
+  m_Bounds[leaf] = box;
+  InsertLeaf(leaf);
+  m_LeafCount++;
+  return leaf;
+}
+
+void DynamicBvh::Remove(int proxy)
+{
+  ASSERT(proxy >= 0 && proxy < (int)m_Nodes.size() && IsLeaf(proxy) && m_Links[proxy].height == 0);
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  m_LeafCount--;
+}
+
+bool DynamicBvh::Move(int proxy, const Aabb& box)
+{
+  ASSERT(proxy >= 0 && proxy < (int)m_Nodes.size() && IsLeaf(proxy) && m_Links[proxy].height == 0);
+  m_Bounds[proxy] = box;
+  Aabb& fat = m_Nodes[proxy].box;
+  if(Contains(fat, box))
+    return false;
+
+  const Aabb old = fat;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    fat.min[c] = box.min[c] - m_Margin;
+    fat.max[c] = box.max[c] + m_Margin;
+  }
+  //a small step keeps the leaf where it is and only grows its ancestors,
+  //an object that jumped away would bloat them, so it looks for a new place
+  if(Overlaps(old, fat))
+    Refit(m_Links[proxy].parent);
+  else
+  {
+    RemoveLeaf(proxy);
+    InsertLeaf(proxy);
+  }
+  return true;
+}
+
+void DynamicBvh::InsertLeaf(int leaf)
+{
+  if(m_Root == NULL_NODE)
+  {
+    m_Root = leaf;
+    m_Links[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  //branch and bound for the sibling with the lowest cost: the area of the new
+  //parent plus the growth it causes in every ancestor. a subtree is skipped once
+  //the leaf's own area plus the growth so far can't beat the best found
+  const Aabb box = m_Nodes[leaf].box;
+  const float leafArea = Area(box);
+  int best = m_Root;
+  float bestCost = FLT_MAX;
+  std::vector<std::pair<int, float>> stack;
+  stack.reserve(m_Links[m_Root].height + 2);
+  stack.push_back(std::make_pair(m_Root, 0.0f));
+  while(!stack.empty())
+  {
+    const int index = stack.back().first;
+    const float inherited = stack.back().second;
+    stack.pop_back();
+
+    const Node& node = m_Nodes[index];
+    const float direct = Area(Union(box, node.box));
+    if(direct + inherited < bestCost)
+    {
+      bestCost = direct + inherited;
+      best = index;
+    }
+    if(node.child[0] == NULL_NODE)
+      continue;
+    const float childInherited = inherited + direct - Area(node.box);
+    if(leafArea + childInherited < bestCost)
+    {
+      stack.push_back(std::make_pair(node.child[0], childInherited));
+      stack.push_back(std::make_pair(node.child[1], childInherited));
+    }
+  }
+
+  const int oldParent = m_Links[best].parent;
+  const int parent = AllocateNode();
+  m_Nodes[parent].child[0] = best;
+  m_Nodes[parent].child[1] = leaf;
+  m_Links[parent].parent = oldParent;
+  m_Links[best].parent = parent;
+  m_Links[leaf].parent = parent;
+  if(oldParent == NULL_NODE)
+    m_Root = parent;
+  else
+  {
+    Node& grand = m_Nodes[oldParent];
+    grand.child[grand.child[0] == best ? 0 : 1] = parent;
+  }
+  Refit(parent);
+}
+
+void DynamicBvh::RemoveLeaf(int leaf)
+{
+  if(leaf == m_Root)
+  {
+    m_Root = NULL_NODE;
+    return;
+  }
+
+  //the sibling takes the place of the parent
+  const int parent = m_Links[leaf].parent;
+  const int grand = m_Links[parent].parent;
+  const int sibling = m_Nodes[parent].child[m_Nodes[parent].child[0] == leaf ? 1 : 0];
+  m_Links[sibling].parent = grand;
+  FreeNode(parent);
+  if(grand == NULL_NODE)
+    m_Root = sibling;
+  else
+  {
+    Node& node = m_Nodes[grand];
+    node.child[node.child[0] == parent ? 0 : 1] = sibling;
+    Refit(grand);
+  }
+}
+
+void DynamicBvh::Refit(int index)
+{
+  while(index != NULL_NODE)
+  {
+    Rotate(index);
+    Node& node = m_Nodes[index];
+    node.box = Union(m_Nodes[node.child[0]].box, m_Nodes[node.child[1]].box);
+    const int h0 = m_Links[node.child[0]].height;
+    const int h1 = m_Links[node.child[1]].height;
+    m_Links[index].height = 1 + (h0 > h1 ? h0 : h1);
+    index = m_Links[index].parent;
+  }
+}
+
+//swaps a child of index with a grandchild under the other child when that shrinks
+//the other child. the box of index stays the same, only the inner one changes
+void DynamicBvh::Rotate(int index)
+{
+  const Node& node = m_Nodes[index];
+  int bestChild = -1, bestGrandchild = -1;
+  float bestGain = 0.0f;
+  for(unsigned int c = 0; c < 2; c++)
+  {
+    const int moved = node.child[c];
+    const int other = node.child[1 - c];
+    if(IsLeaf(other))
+      continue;
+    const Node& inner = m_Nodes[other];
+    const float area = Area(inner.box);
+    for(unsigned int g = 0; g < 2; g++)
+    {
+      //moved takes the place of grandchild g, which moves up
+      const float gain = area - Area(Union(m_Nodes[moved].box, m_Nodes[inner.child[1 - g]].box));
+      if(gain > bestGain)
+      {
+        bestGain = gain;
+        bestChild = c;
+        bestGrandchild = g;
+      }
+    }
+  }
+  if(bestChild < 0)
+    return;
+
+  const int moved = m_Nodes[index].child[bestChild];
+  const int other = m_Nodes[index].child[1 - bestChild];
+  Node& inner = m_Nodes[other];
+  const int lifted = inner.child[bestGrandchild];
+  m_Nodes[index].child[bestChild] = lifted;
+  inner.child[bestGrandchild] = moved;
+  m_Links[lifted].parent = index;
+  m_Links[moved].parent = other;
+
+  inner.box = Union(m_Nodes[inner.child[0]].box, m_Nodes[inner.child[1]].box);
+  const int h0 = m_Links[inner.child[0]].height;
+  const int h1 = m_Links[inner.child[1]].height;
+  m_Links[other].height = 1 + (h0 > h1 ? h0 : h1);
+}
+
+unsigned int DynamicBvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const
+{
+  result.clear();
+  if(m_Root == NULL_NODE)
+    return 0;
+
+  //the mask holds the planes a node still straddles, once it is inside all of
+  //them the whole subtree is visible without further tests
+  std::vector<std::pair<int, unsigned int>> stack;
+  stack.reserve(m_Links[m_Root].height + 2);
+  stack.push_back(std::make_pair(m_Root, 0x3fu));
+  while(!stack.empty())
+  {
+    const int index = stack.back().first;
+    unsigned int mask = stack.back().second;
+    stack.pop_back();
+
+    const Node& node = m_Nodes[index];
+    const bool leaf = node.child[0] == NULL_NODE;
+    const Aabb& box = leaf ? m_Bounds[index] : node.box;
+    bool outside = false;
+    for(unsigned int p = 0; p < 6 && !outside; p++)
+    {
+      if(!(mask & (1 << p)))
+        continue;
+      const float* plane = frustum.planes[p];
+      float d = plane[3], r = 0.0f;
+      for(unsigned int c = 0; c < 3; c++)
+      {
+        d += plane[c] * (box.min[c] + box.max[c]) * 0.5f;
+        r += std::fabs(plane[c]) * (box.max[c] - box.min[c]) * 0.5f;
+      }
+      if(d + r < 0.0f)
+        outside = true;
+      else if(d - r >= 0.0f)
+        mask &= ~(1u << p);
+    }
+    if(outside)
+      continue;
+
+    if(leaf)
+      result.push_back((unsigned int)node.child[1]);
+    else
+    {
+      stack.push_back(std::make_pair(node.child[0], mask));
+      stack.push_back(std::make_pair(node.child[1], mask));
+    }
+  }
+  return (unsigned int)result.size();
+}
+
+unsigned int DynamicBvh::QueryAabb(const Aabb& box, std::vector<unsigned int>& result) const
+{
+  result.clear();
+  if(m_Root == NULL_NODE)
+    return 0;
+
+  std::vector<int> stack;
+  stack.reserve(m_Links[m_Root].height + 2);
+  stack.push_back(m_Root);
+  while(!stack.empty())
+  {
+    const int index = stack.back();
+    stack.pop_back();
+    const Node& node = m_Nodes[index];
+    if(node.child[0] == NULL_NODE)
+    {
+      if(Overlaps(m_Bounds[index], box))
+        result.push_back((unsigned int)node.child[1]);
+    }
+    else if(Overlaps(node.box, box))
+    {
+      stack.push_back(node.child[0]);
+      stack.push_back(node.child[1]);
+    }
+  }
+  return (unsigned int)result.size();
+}
+
+//squared distance from a point to the closest point of a box, 0 inside
+static float DistanceSquared(const Aabb& box, const float* point)
+{
+  float distance = 0.0f;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    float d = 0.0f;
+    if(point[c] < box.min[c])
+      d = box.min[c] - point[c];
+    else if(point[c] > box.max[c])
+      d = point[c] - box.max[c];
+    distance += d * d;
+  }
+  return distance;
+}
+
+unsigned int DynamicBvh::QuerySphere(const float* center, float radius, std::vector<unsigned int>& result) const
+{
+  result.clear();
+  if(m_Root == NULL_NODE)
+    return 0;
+
+  const float radiusSquared = radius * radius;
+  std::vector<int> stack;
+  stack.reserve(m_Links[m_Root].height + 2);
+  stack.push_back(m_Root);
+  while(!stack.empty())
+  {
+    const int index = stack.back();
+    stack.pop_back();
+    const Node& node = m_Nodes[index];
+    if(node.child[0] == NULL_NODE)
+    {
+      if(DistanceSquared(m_Bounds[index], center) <= radiusSquared)
+        result.push_back((unsigned int)node.child[1]);
+    }
+    else if(DistanceSquared(node.box, center) <= radiusSquared)
+    {
+      stack.push_back(node.child[0]);
+      stack.push_back(node.child[1]);
+    }
+  }
+  return (unsigned int)result.size();
+}
+
+//slab test, returns the distance where the ray enters the box or -1 if it misses
+//before maxDistance. a ray starting inside enters at 0
+static float RayEnter(const Aabb& box, const float* origin, const float* inverse, float maxDistance)
+{
+  float enter = 0.0f, exit = maxDistance;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    float t0 = (box.min[c] - origin[c]) * inverse[c];
+    float t1 = (box.max[c] - origin[c]) * inverse[c];
+    if(t0 > t1)
+    {
+      const float t = t0;
+      t0 = t1;
+      t1 = t;
+    }
+    //nan from 0 * inf (origin on a slab of a parallel axis) keeps the old limits
+    enter = t0 > enter ? t0 : enter;
+    exit = t1 < exit ? t1 : exit;
+    if(enter > exit)
+      return -1.0f;
+  }
+  return enter;
+}
+
+bool DynamicBvh::RayCast(const Ray& ray, float maxDistance, RayHit& hit) const
+{
+  if(m_Root == NULL_NODE)
+    return false;
+
+  float inverse[3];
+  for(unsigned int c = 0; c < 3; c++)
+    inverse[c] = 1.0f / ray.direction[c];
+
+  //nodes come off the stack nearest first and are skipped once a closer hit is known
+  float best = maxDistance;
+  bool found = false;
+  std::vector<std::pair<int, float>> stack;
+  stack.reserve(m_Links[m_Root].height + 2);
+  const float rootEnter = RayEnter(m_Nodes[m_Root].box, ray.origin, inverse, best);
+  if(rootEnter >= 0.0f)
+    stack.push_back(std::make_pair(m_Root, rootEnter));
+  while(!stack.empty())
+  {
+    const int index = stack.back().first;
+    const float enter = stack.back().second;
+    stack.pop_back();
+    if(enter > best)
+      continue;
+
+    const Node& node = m_Nodes[index];
+    if(node.child[0] == NULL_NODE)
+    {
+      const float t = RayEnter(m_Bounds[index], ray.origin, inverse, best);
+      if(t >= 0.0f && (!found || t < best))
+      {
+        best = t;
+        found = true;
+        hit.userData = (unsigned int)node.child[1];
+        hit.distance = t;
+      }
+      continue;
+    }
+
+    const float t0 = RayEnter(m_Nodes[node.child[0]].box, ray.origin, inverse, best);
+    const float t1 = RayEnter(m_Nodes[node.child[1]].box, ray.origin, inverse, best);
+    //push the farther child first so the nearer one is searched first
+    const bool nearFirst = t0 >= 0.0f && (t1 < 0.0f || t0 <= t1);
+    const int nearChild = nearFirst ? 0 : 1;
+    const float tNear = nearFirst ? t0 : t1, tFar = nearFirst ? t1 : t0;
+    if(tFar >= 0.0f)
+      stack.push_back(std::make_pair(node.child[1 - nearChild], tFar));
+    if(tNear >= 0.0f)
+      stack.push_back(std::make_pair(node.child[nearChild], tNear));
+  }
+  return found;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include "FrustumCuller.h"
+
+struct Aabb
+{
+  float min[3];
+  float max[3];
+};
+
+struct Ray
+{
+  float origin[3];
+  float direction[3]; //hit distances are measured in multiples of it
+
+  //picking ray through a point in normalized device coordinates (-1..1) of a
+  //column-major view-projection matrix, distance 0 is the near plane, 1 the far plane
+  static Ray FromScreen(const float* viewProjection, float x, float y);
+};
+
+struct RayHit
+{
+  unsigned int userData;
+  float distance;
+};
+
+//dynamic AABB tree over objects that move, appear and disappear every frame.
+//leaves keep a box grown by a margin, so small movements don't touch the tree,
+//larger ones refit the path to the root in place and only teleports reinsert.
+//insertion picks the sibling with the lowest surface area cost (SAH) and every
+//change rotates the nodes on its way up to keep the tree shallow.
+//queries use the exact boxes at the leaves, so results contain no margin.
+//
+//hierarchical culling: whole subtrees are dropped or accepted with one test,
+//  bvh.QueryFrustum(Frustum::FromMatrix(viewProj), visible);
+//  renderer.Submit(packets.data(), visible);
+//with the packet index as user data.
+class DynamicBvh
+{
+public:
+  static const int NULL_NODE = -1;
+
+private:
+  //everything a query reads, two nodes per cache line
+  struct alignas(32) Node
+  {
+    Aabb box;     //fattened box of a leaf, union of the children otherwise
+    int child[2]; //child[0] == NULL_NODE marks a leaf, child[1] then holds its user data
+  };
+  //only needed while the tree changes, kept apart so queries don't drag it through the cache
+  struct NodeLinks
+  {
+    int parent;   //next free node while on the free list
+    int height;   //0 for leaves, -1 for free nodes
+  };
+
+  //nodes are addressed by index and recycled through the free list, so proxies stay valid
+  std::vector<Node> m_Nodes;
+  std::vector<NodeLinks> m_Links;
+  std::vector<Aabb> m_Bounds; //exact box of each leaf
+  int m_Root;
+  int m_FreeList;
+  unsigned int m_LeafCount;
+  float m_Margin;
+
+  int AllocateNode();
+  void FreeNode(int index);
+  void InsertLeaf(int leaf);
+  void RemoveLeaf(int leaf);
+  //recomputes boxes and heights from index up to the root, rotating where it pays off
+  void Refit(int index);
+  void Rotate(int index);
+  inline bool IsLeaf (int index) const {return m_Nodes[index].child[0] == NULL_NODE;}
+
+public:
+  //margin is added on every side of the boxes stored in the leaves
+  explicit DynamicBvh(float margin = 0.1f);
+
+  //returns the proxy of the object, valid until it is removed
+  int Insert(const Aabb& box, unsigned int userData);
+  void Remove(int proxy);
+  //returns true if the tree had to change
+  bool Move(int proxy, const Aabb& box);
+
+  //every query clears result, fills it with the user data of the hits and returns how many
+  unsigned int QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const;
+  unsigned int QueryAabb(const Aabb& box, std::vector<unsigned int>& result) const;
+  //objects whose box is within radius of center, for proximity checks
+  unsigned int QuerySphere(const float* center, float radius, std::vector<unsigned int>& result) const;
+  //nearest box the ray enters within maxDistance, false if there is none
+  bool RayCast(const Ray& ray, float maxDistance, RayHit& hit) const;
+
+  inline unsigned int GetUserData (int proxy) const {return (unsigned int)m_Nodes[proxy].child[1];}
+  inline const Aabb& GetBox (int proxy) const {return m_Bounds[proxy];}
+  inline const Aabb& GetFatBox (int proxy) const {return m_Nodes[proxy].box;}
+  inline unsigned int GetLeafCount () const {return m_LeafCount;}
+  inline int GetHeight () const {return m_Root == NULL_NODE ? 0 : m_Links[m_Root].height;}
+};
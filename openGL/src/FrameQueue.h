@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+//lock-free single producer / single consumer queue over Count preallocated slots.
+//with the default two slots the producer fills one frame while the consumer works
+//on the other, so the producer runs at most one frame ahead.
+//slots are reused, never constructed or destroyed per frame.
+template<typename T, unsigned int Count = 2>
+class FrameQueue
+{
+private:
+  static_assert(Count > 0 && (Count & (Count - 1)) == 0, "slot count must be a power of two");
+
+  T m_Slots[Count];
+  //each counter is written by one side only, separate cache lines keep them from ping-ponging
+  alignas(64) std::atomic<unsigned int> m_Written;
+  alignas(64) std::atomic<unsigned int> m_Read;
+
+  //spin briefly, then yield, then sleep so a long wait (vsync) doesn't burn a core
+  template<typename Fn>
+  static T* Wait(Fn tryAcquire, const std::atomic<bool>& running)
+  {
+    for(unsigned int spins = 0; ; spins++)
+    {
+      if(T* slot = tryAcquire())
+        return slot;
+      if(!running.load(std::memory_order_relaxed))
+        return nullptr;
+      if(spins < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+public:
+  FrameQueue()
+    : m_Written(0), m_Read(0) {};
+
+  FrameQueue(const FrameQueue&) = delete;
+  FrameQueue& operator=(const FrameQueue&) = delete;
+
+  //producer side: the slot to fill, nullptr while the consumer still holds every slot
+  T* TryBeginWrite()
+  {
+    const unsigned int written = m_Written.load(std::memory_order_relaxed);
+    if(written - m_Read.load(std::memory_order_acquire) == Count)
+      return nullptr;
+    return &m_Slots[written & (Count - 1)];
+  }
+  //publishes the slot returned by the last BeginWrite
+  void EndWrite()
+  {
+    m_Written.store(m_Written.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  //consumer side: the oldest published slot, nullptr if there is none
+  T* TryBeginRead()
+  {
+    const unsigned int read = m_Read.load(std::memory_order_relaxed);
+    if(read == m_Written.load(std::memory_order_acquire))
+      return nullptr;
+    return &m_Slots[read & (Count - 1)];
+  }
+  //hands the slot back to the producer
+  void EndRead()
+  {
+    m_Read.store(m_Read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  //blocking versions, they give up and return nullptr once running turns false
+  T* BeginWrite(const std::atomic<bool>& running)
+  {
+    return Wait([this]() { return TryBeginWrite(); }, running);
+  }
+  T* BeginRead(const std::atomic<bool>& running)
+  {
+    return Wait([this]() { return TryBeginRead(); }, running);
+  }
+};
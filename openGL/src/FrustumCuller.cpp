@@ -0,0 +1,400 @@
+#include "FrustumCuller.h"
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Renderer.h"
+
+#if defined(__AVX2__)
+#define CULL_AVX2
+#include <immintrin.h>
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define CULL_SSE2
+#include <emmintrin.h>
+#endif
+
+//a thread only pays off with enough work to hide waking it: at ~1.5 ns per object
+//a chunk of 32K takes ~50us, several times the wake-up of a parked worker
+static const unsigned int MIN_CHUNK = 1 << 15;
+//the kernels may store up to this many indices past the last visible one
+static const unsigned int OUTPUT_SLACK = 8;
+//extent of unused slots, fails every plane for spheres and boxes alike
+static const float CULLED_EXTENT = -FLT_MAX;
+
+Frustum Frustum::FromMatrix(const float* viewProjection)
+{
+  //row r of a column-major matrix is m[r], m[4 + r], m[8 + r], m[12 + r].
+  //left/right = row3 +- row0, bottom/top = row3 +- row1, near/far = row3 +- row2
+  Frustum frustum;
+  for(unsigned int p = 0; p < 6; p++)
+  {
+    const unsigned int row = p / 2;
+    const float sign = (p & 1) ? -1.0f : 1.0f;
+    float* plane = frustum.planes[p];
+    for(unsigned int c = 0; c < 4; c++)
+      plane[c] = viewProjection[c * 4 + 3] + sign * viewProjection[c * 4 + row];
+
+    const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    if(length > 0.0f)
+    {
+      for(unsigned int c = 0; c < 4; c++)
+        plane[c] /= length;
+    }
+  }
+  return frustum;
+}
+
+FrustumCuller::FrustumCuller(BoundsType type)
+  : m_Type(type), m_Count(0)
+{
+}
+
+void FrustumCuller::Resize(unsigned int count)
+{
+  const unsigned int padded = (count + 7) & ~7u;
+  const unsigned int extents = m_Type == BoundsType::SPHERE ? 1 : 3;
+  for(unsigned int c = 0; c < 3; c++)
+    m_Center[c].resize(padded, 0.0f);
+  for(unsigned int c = 0; c < extents; c++)
+  {
+    m_Extent[c].resize(padded, CULLED_EXTENT);
+    //slots dropped by a shrink become padding again
+    for(unsigned int i = count; i < m_Count && i < padded; i++)
+      m_Extent[c][i] = CULLED_EXTENT;
+  }
+  m_Count = count;
+}
+
+void FrustumCuller::SetSphere(unsigned int index, float x, float y, float z, float radius)
+{
+  ASSERT(m_Type == BoundsType::SPHERE && index < m_Count);
+  m_Center[0][index] = x;
+  m_Center[1][index] = y;
+  m_Center[2][index] = z;
+  m_Extent[0][index] = radius;
+}
+
+void FrustumCuller::SetBox(unsigned int index, const float* center, const float* halfExtents)
+{
+  ASSERT(m_Type == BoundsType::BOX && index < m_Count);
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    m_Center[c][index] = center[c];
+    m_Extent[c][index] = halfExtents[c];
+  }
+}
+
+struct CullInput
+{
+  const float* center[3];
+  const float* extent[3]; //extent[0] is the radius for spheres
+};
+
+//an object is visible unless it lies entirely behind one plane:
+//sphere: n.c + d + r >= 0, box: n.c + d + |n|.e >= 0 for all six planes.
+//every kernel writes visible indices branch free and returns how many it found
+template<bool Sphere>
+static unsigned int CullScalar(const CullInput& in, const Frustum& frustum, unsigned int begin, unsigned int end,
+  unsigned int* visible)
+{
+  unsigned int count = 0;
+  for(unsigned int i = begin; i < end; i++)
+  {
+    bool inside = true;
+    for(unsigned int p = 0; p < 6 && inside; p++)
+    {
+      const float* plane = frustum.planes[p];
+      float d = plane[0] * in.center[0][i] + plane[1] * in.center[1][i] + plane[2] * in.center[2][i] + plane[3];
+      if(Sphere)
+        d += in.extent[0][i];
+      else
+        d += std::fabs(plane[0]) * in.extent[0][i] + std::fabs(plane[1]) * in.extent[1][i] +
+          std::fabs(plane[2]) * in.extent[2][i];
+      inside = d >= 0.0f;
+    }
+    visible[count] = i;
+    count += inside ? 1 : 0;
+  }
+  return count;
+}
+
+#ifdef CULL_AVX2
+//for each 8 bit visibility mask the lane order that packs the visible lanes to the front
+struct CompactTable
+{
+  alignas(32) int permute[256][8];
+  unsigned char count[256];
+};
+
+static const CompactTable& GetCompactTable()
+{
+  static const CompactTable table = []()
+  {
+    CompactTable t;
+    for(unsigned int mask = 0; mask < 256; mask++)
+    {
+      unsigned int n = 0;
+      for(unsigned int lane = 0; lane < 8; lane++)
+      {
+        if(mask & (1 << lane))
+          t.permute[mask][n++] = lane;
+      }
+      t.count[mask] = (unsigned char)n;
+      for(; n < 8; n++)
+        t.permute[mask][n] = 0;
+    }
+    return t;
+  }();
+  return table;
+}
+
+template<bool Sphere>
+static unsigned int CullAvx2(const CullInput& in, const Frustum& frustum, unsigned int begin, unsigned int end,
+  unsigned int* visible)
+{
+  const CompactTable& table = GetCompactTable();
+  __m256 n[6][3], a[6][3], w[6];
+  for(unsigned int p = 0; p < 6; p++)
+  {
+    for(unsigned int c = 0; c < 3; c++)
+    {
+      n[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+      a[p][c] = _mm256_set1_ps(std::fabs(frustum.planes[p][c]));
+    }
+    w[p] = _mm256_set1_ps(frustum.planes[p][3]);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  unsigned int count = 0;
+  for(unsigned int i = begin; i < end; i += 8)
+  {
+    const __m256 x = _mm256_loadu_ps(in.center[0] + i);
+    const __m256 y = _mm256_loadu_ps(in.center[1] + i);
+    const __m256 z = _mm256_loadu_ps(in.center[2] + i);
+    const __m256 ex = _mm256_loadu_ps(in.extent[0] + i);
+    const __m256 ey = Sphere ? ex : _mm256_loadu_ps(in.extent[1] + i);
+    const __m256 ez = Sphere ? ex : _mm256_loadu_ps(in.extent[2] + i);
+
+    int mask = 0xff;
+    for(unsigned int p = 0; p < 6 && mask; p++)
+    {
+      __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n[p][0], x), _mm256_mul_ps(n[p][1], y)),
+        _mm256_add_ps(_mm256_mul_ps(n[p][2], z), w[p]));
+      if(Sphere)
+        d = _mm256_add_ps(d, ex);
+      else
+        d = _mm256_add_ps(d, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[p][0], ex), _mm256_mul_ps(a[p][1], ey)),
+          _mm256_mul_ps(a[p][2], ez)));
+      mask &= _mm256_movemask_ps(_mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+    }
+
+    //pack the visible indices with one permute, the unused tail lanes get overwritten next step
+    const __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int)i), lanes);
+    const __m256i order = _mm256_load_si256((const __m256i*)table.permute[mask]);
+    _mm256_storeu_si256((__m256i*)(visible + count), _mm256_permutevar8x32_epi32(index, order));
+    count += table.count[mask];
+  }
+  return count;
+}
+#endif
+
+#ifdef CULL_SSE2
+template<bool Sphere>
+static unsigned int CullSse2(const CullInput& in, const Frustum& frustum, unsigned int begin, unsigned int end,
+  unsigned int* visible)
+{
+  __m128 n[6][3], a[6][3], w[6];
+  for(unsigned int p = 0; p < 6; p++)
+  {
+    for(unsigned int c = 0; c < 3; c++)
+    {
+      n[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+      a[p][c] = _mm_set1_ps(std::fabs(frustum.planes[p][c]));
+    }
+    w[p] = _mm_set1_ps(frustum.planes[p][3]);
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  unsigned int count = 0;
+  for(unsigned int i = begin; i < end; i += 4)
+  {
+    const __m128 x = _mm_loadu_ps(in.center[0] + i);
+    const __m128 y = _mm_loadu_ps(in.center[1] + i);
+    const __m128 z = _mm_loadu_ps(in.center[2] + i);
+    const __m128 ex = _mm_loadu_ps(in.extent[0] + i);
+    const __m128 ey = Sphere ? ex : _mm_loadu_ps(in.extent[1] + i);
+    const __m128 ez = Sphere ? ex : _mm_loadu_ps(in.extent[2] + i);
+
+    int mask = 0xf;
+    for(unsigned int p = 0; p < 6 && mask; p++)
+    {
+      __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[p][0], x), _mm_mul_ps(n[p][1], y)),
+        _mm_add_ps(_mm_mul_ps(n[p][2], z), w[p]));
+      if(Sphere)
+        d = _mm_add_ps(d, ex);
+      else
+        d = _mm_add_ps(d, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[p][0], ex), _mm_mul_ps(a[p][1], ey)),
+          _mm_mul_ps(a[p][2], ez)));
+      mask &= _mm_movemask_ps(_mm_cmpge_ps(d, zero));
+    }
+
+    for(unsigned int lane = 0; lane < 4; lane++)
+    {
+      visible[count] = i + lane;
+      count += (mask >> lane) & 1;
+    }
+  }
+  return count;
+}
+#endif
+
+template<bool Sphere>
+static unsigned int CullRange(const CullInput& in, const Frustum& frustum, unsigned int begin, unsigned int end,
+  unsigned int* visible)
+{
+#if defined(CULL_AVX2)
+  return CullAvx2<Sphere>(in, frustum, begin, end, visible);
+#elif defined(CULL_SSE2)
+  return CullSse2<Sphere>(in, frustum, begin, end, visible);
+#else
+  return CullScalar<Sphere>(in, frustum, begin, end, visible);
+#endif
+}
+
+//workers are started on the first parallel cull and then parked between culls,
+//creating threads per call would cost more than the culling itself
+class CullWorkers
+{
+private:
+  std::vector<std::thread> m_Threads;
+  std::mutex m_RunMutex; //one cull at a time owns the workers
+  std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+  std::condition_variable m_Done;
+  const std::function<void(unsigned int)>* m_Job;
+  unsigned int m_JobThreads;
+  unsigned int m_Pending;
+  unsigned int m_Generation;
+  bool m_Exit;
+
+  void Work(unsigned int t)
+  {
+    unsigned int seen = 0;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for(;;)
+    {
+      m_Wake.wait(lock, [&]() { return m_Exit || m_Generation != seen; });
+      if(m_Exit)
+        return;
+      seen = m_Generation;
+      if(t >= m_JobThreads)
+        continue;
+      const std::function<void(unsigned int)>* job = m_Job;
+      lock.unlock();
+      (*job)(t);
+      lock.lock();
+      if(--m_Pending == 0)
+        m_Done.notify_one();
+    }
+  }
+
+public:
+  explicit CullWorkers(unsigned int count)
+    : m_Job(nullptr), m_JobThreads(0), m_Pending(0), m_Generation(0), m_Exit(false)
+  {
+    for(unsigned int t = 1; t < count; t++)
+      m_Threads.push_back(std::thread(&CullWorkers::Work, this, t));
+  }
+
+  ~CullWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Exit = true;
+    }
+    m_Wake.notify_all();
+    for(unsigned int t = 0; t < m_Threads.size(); t++)
+      m_Threads[t].join();
+  }
+
+  //the calling thread counts as one of them
+  inline unsigned int GetCount () const {return (unsigned int)m_Threads.size() + 1;}
+
+  //runs job(0 .. threadCount - 1), job(0) on the calling thread
+  void Run(unsigned int threadCount, const std::function<void(unsigned int)>& job)
+  {
+    std::lock_guard<std::mutex> run(m_RunMutex);
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Job = &job;
+      m_JobThreads = threadCount;
+      m_Pending = threadCount - 1;
+      m_Generation++;
+    }
+    m_Wake.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Done.wait(lock, [&]() { return m_Pending == 0; });
+  }
+};
+
+static CullWorkers& GetWorkers()
+{
+  static CullWorkers workers([]()
+  {
+    const unsigned int threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads > 16 ? 16 : threads;
+  }());
+  return workers;
+}
+
+unsigned int FrustumCuller::Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+  const unsigned int size = (unsigned int)m_Center[0].size();
+  const unsigned int blocks = size / 8;
+  unsigned int threadCount = size / MIN_CHUNK;
+  if(threadCount > 1)
+  {
+    const unsigned int workers = GetWorkers().GetCount();
+    threadCount = threadCount < workers ? threadCount : workers;
+  }
+  else
+    threadCount = 1;
+  const bool sphere = m_Type == BoundsType::SPHERE;
+  CullInput in;
+  for(unsigned int c = 0; c < 3; c++)
+  {
+    in.center[c] = m_Center[c].data();
+    in.extent[c] = sphere ? m_Extent[0].data() : m_Extent[c].data();
+  }
+
+  //every thread culls whole blocks of 8 into its own part of visible, the parts
+  //are then moved together in order, so the result never depends on the thread count
+  visible.resize(size + threadCount * OUTPUT_SLACK);
+  std::vector<unsigned int> counts(threadCount);
+  const std::function<void(unsigned int)> job = [&](unsigned int t)
+  {
+    const unsigned int begin = (unsigned int)((unsigned long long)blocks * t / threadCount) * 8;
+    const unsigned int end = (unsigned int)((unsigned long long)blocks * (t + 1) / threadCount) * 8;
+    unsigned int* out = visible.data() + begin + t * OUTPUT_SLACK;
+    counts[t] = sphere ? CullRange<true>(in, frustum, begin, end, out) : CullRange<false>(in, frustum, begin, end, out);
+  };
+  if(threadCount == 1)
+    job(0);
+  else
+    GetWorkers().Run(threadCount, job);
+
+  unsigned int total = counts[0];
+  for(unsigned int t = 1; t < threadCount; t++)
+  {
+    const unsigned int begin = (unsigned int)((unsigned long long)blocks * t / threadCount) * 8;
+    memmove(visible.data() + total, visible.data() + begin + t * OUTPUT_SLACK, counts[t] * sizeof(unsigned int));
+    total += counts[t];
+  }
+  visible.resize(total);
+  return total;
+}
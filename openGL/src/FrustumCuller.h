@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+
+//six inward facing planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside.
+//order: left, right, bottom, top, near, far
+struct Frustum
+{
+  float planes[6][4];
+
+  //extracts the planes of a column-major view-projection matrix (Gribb/Hartmann),
+  //normalized so plane distances are in world units
+  static Frustum FromMatrix(const float* viewProjection);
+};
+
+//bounding volumes of many objects kept as structure of arrays, so one
+//SIMD register holds the same coordinate of 8 objects. culling tests 8 objects
+//per step with AVX2 (4 with SSE2, else scalar) and writes the indices of
+//the visible ones in increasing order, ready to drive the draw submission:
+//  culler.Cull(Frustum::FromMatrix(viewProj), visible);
+//  renderer.Submit(packets.data(), visible);
+class FrustumCuller
+{
+public:
+  enum class BoundsType
+  {
+    SPHERE, //center + radius
+    BOX     //axis aligned, center + half extents
+  };
+
+private:
+  BoundsType m_Type;
+  unsigned int m_Count;
+  //x, y, z of the centers and the radius (m_Extent[0]) or the x, y, z half extents.
+  //sized to a multiple of 8 so the kernels never need a tail, the padding is always culled
+  std::vector<float> m_Center[3];
+  std::vector<float> m_Extent[3];
+
+public:
+  explicit FrustumCuller(BoundsType type = BoundsType::SPHERE);
+
+  //objects are addressed by index, new ones start out culled (empty box / negative radius)
+  void Resize(unsigned int count);
+  void SetSphere(unsigned int index, float x, float y, float z, float radius);
+  void SetBox(unsigned int index, const float* center, const float* halfExtents);
+
+  //fills visible with the indices of all objects intersecting the frustum, returns how many.
+  //large counts are split across threads
+  unsigned int Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+  inline BoundsType GetBoundsType () const {return m_Type;}
+  inline unsigned int GetCount () const {return m_Count;}
+};
@@ -1,8 +1,8 @@
 #include "IndexBuffer.h"
 #include "Renderer.h"
 
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
-  : m_Count(count)
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count, unsigned int topology)
+  : m_Count(count), m_Topology(topology)
 {
   //might not be always true based on certain platforms.
   //used for safety purpose only
@@ -1,8 +1,11 @@
 #pragma once
+#include <glew.h>
+
 class IndexBuffer
 {
 public:
-  IndexBuffer(const unsigned int* data, unsigned int count);
+  //topology is the primitive mode passed to the draw call, e.g. GL_TRIANGLE_STRIP
+  IndexBuffer(const unsigned int* data, unsigned int count, unsigned int topology = GL_TRIANGLES);
   ~IndexBuffer(void);
 
 
@@ -10,8 +13,11 @@ public:
   void Unbind() const;
 
   inline unsigned int GetCount () const {return m_Count;}
+  inline unsigned int GetTopology () const {return m_Topology;}
+  inline unsigned int GetRendererId () const {return m_RendererId;}
 private:
   unsigned int m_RendererId;
   unsigned int m_Count;
+  unsigned int m_Topology;
 };
 
@@ -0,0 +1,30 @@
+//the prebuilt GLFW in dependencies/GLFW/lib-vc2012 was compiled against the VS2012 CRT
+//and imports _vsnprintf / sscanf from its dll. since VS2015 the stdio functions are
+//inline in the headers, legacy_stdio_definitions.lib brings back the plain symbols but
+//not the __imp__ pointers a /MD library links against, so they are provided here.
+//drop this file once GLFW is rebuilt with the project's toolset.
+#if defined(_MSC_VER) && _MSC_VER >= 1900 && defined(_M_IX86)
+#include <cstdarg>
+#include <cstdio>
+
+static int __cdecl LegacyVsnprintf(char* buffer, size_t count, const char* format, va_list args)
+{
+  return _vsnprintf(buffer, count, format, args);
+}
+
+static int __cdecl LegacySscanf(const char* buffer, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  const int result = vsscanf(buffer, format, args);
+  va_end(args);
+  return result;
+}
+
+//x86 C names get a leading underscore, so these end up as __imp__vsnprintf and __imp__sscanf
+extern "C"
+{
+  int (__cdecl* _imp__vsnprintf)(char*, size_t, const char*, va_list) = LegacyVsnprintf;
+  int (__cdecl* _imp__sscanf)(const char*, const char*, ...) = LegacySscanf;
+}
+#endif
@@ -0,0 +1,74 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+  : m_Path(path), m_Data(nullptr), m_Size(0), m_Valid(false)
+{
+#ifdef _WIN32
+  m_Mapping = nullptr;
+  //share write/delete so editors can still save over a file that is mapped
+  m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(m_File == INVALID_HANDLE_VALUE)
+    return;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(m_File, &size))
+    return;
+  m_Size = (size_t)size.QuadPart;
+  m_Valid = true;
+  if(m_Size == 0)
+    return; //empty files cannot be mapped
+
+  m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(m_Mapping)
+    m_Data = (const char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+  m_Valid = m_Data != nullptr;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    return;
+
+  struct stat info;
+  if(fstat(fd, &info) == 0)
+  {
+    m_Size = (size_t)info.st_size;
+    m_Valid = true;
+    if(m_Size > 0)
+    {
+      void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+      m_Data = data == MAP_FAILED ? nullptr : (const char*)data;
+      m_Valid = m_Data != nullptr;
+    }
+  }
+  //the mapping stays valid after the descriptor is closed
+  close(fd);
+#endif
+  if(!m_Valid)
+    m_Size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  if(m_Data)
+    UnmapViewOfFile(m_Data);
+  if(m_Mapping)
+    CloseHandle(m_Mapping);
+  if(m_File != INVALID_HANDLE_VALUE)
+    CloseHandle(m_File);
+#else
+  if(m_Data)
+    munmap((void*)m_Data, m_Size);
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+//read-only memory mapping of a whole file
+class MappedFile
+{
+private:
+  std::string m_Path;
+  const char* m_Data;
+  size_t m_Size;
+  bool m_Valid;
+#ifdef _WIN32
+  void* m_File;
+  void* m_Mapping;
+#endif
+
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  inline bool IsValid () const {return m_Valid;}
+  inline const std::string& GetPath () const {return m_Path;}
+  inline std::string_view GetView () const {return std::string_view(m_Data, m_Size);}
+};
@@ -0,0 +1,479 @@
+#include "MeshCodec.h"
+#include "Renderer.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MESHCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+static const unsigned char INDEX_CODEC_VERSION = 1;
+static const unsigned char VERTEX_CODEC_VERSION = 1;
+static const unsigned int MESH_FILE_MAGIC = 0x4348534d; //"MSHC"
+
+//the top nibble of a triangle code is the edge fifo slot, 15 means "no edge"
+static const unsigned int EDGE_FIFO_SIZE = 16;
+static const unsigned int EDGE_NONE = 15;
+
+struct EdgeFifo
+{
+  unsigned int edges[EDGE_FIFO_SIZE][2];
+  unsigned int head;
+
+  EdgeFifo()
+    : head(0)
+  {
+    memset(edges, 0xff, sizeof(edges));
+  }
+
+  //returns how many pushes ago the edge was added, or -1
+  int Find(unsigned int a, unsigned int b) const
+  {
+    for(unsigned int i = 0; i < EDGE_NONE; i++)
+    {
+      const unsigned int* e = edges[(head - 1 - i) & (EDGE_FIFO_SIZE - 1)];
+      if(e[0] == a && e[1] == b)
+        return (int)i;
+    }
+    return -1;
+  }
+
+  const unsigned int* Get(unsigned int i) const
+  {
+    return edges[(head - 1 - i) & (EDGE_FIFO_SIZE - 1)];
+  }
+
+  void Push(unsigned int a, unsigned int b)
+  {
+    edges[head & (EDGE_FIFO_SIZE - 1)][0] = a;
+    edges[head & (EDGE_FIFO_SIZE - 1)][1] = b;
+    head++;
+  }
+
+  //a neighbouring triangle walks the shared edge in the opposite direction
+  void PushTriangle(unsigned int a, unsigned int b, unsigned int c)
+  {
+    Push(b, a);
+    Push(c, b);
+    Push(a, c);
+  }
+};
+
+static void WriteVarint(std::vector<unsigned char>& out, unsigned int v)
+{
+  while(v >= 0x80)
+  {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+static bool ReadVarint(const unsigned char*& p, const unsigned char* end, unsigned int& v)
+{
+  v = 0;
+  for(unsigned int shift = 0; shift < 35; shift += 7)
+  {
+    if(p == end)
+      return false;
+    unsigned char b = *p++;
+    v |= (unsigned int)(b & 0x7f) << shift;
+    if(!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static unsigned int ZigZag(int v)
+{
+  //on unsigned values, shifting a negative int left is undefined
+  const unsigned int u = (unsigned int)v;
+  return (u << 1) ^ (0u - (u >> 31));
+}
+
+static int UnZigZag(unsigned int v)
+{
+  return (int)((v >> 1) ^ (0u - (v & 1)));
+}
+
+std::vector<unsigned char> EncodeIndexBuffer(const unsigned int* indices, unsigned int indexCount)
+{
+  ASSERT(indexCount % 3 == 0);
+  std::vector<unsigned char> out;
+  out.reserve(indexCount + 1);
+  out.push_back(INDEX_CODEC_VERSION);
+
+  EdgeFifo fifo;
+  unsigned int next = 0; //the next vertex that has never been referenced, if indices are in first-use order
+  unsigned int last = 0;
+
+  for(unsigned int i = 0; i < indexCount; i += 3)
+  {
+    const unsigned int tri[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+    int edge = -1;
+    unsigned int rotation = 0;
+    for(unsigned int r = 0; r < 3 && edge < 0; r++)
+    {
+      edge = fifo.Find(tri[r], tri[(r + 1) % 3]);
+      rotation = r;
+    }
+
+    if(edge >= 0)
+    {
+      const unsigned int x = tri[rotation], y = tri[(rotation + 1) % 3], z = tri[(rotation + 2) % 3];
+      if(z == next)
+      {
+        out.push_back((unsigned char)(edge << 4));
+        next++;
+      }
+      else
+      {
+        out.push_back((unsigned char)((edge << 4) | 1));
+        WriteVarint(out, ZigZag((int)(z - last)));
+      }
+      last = z;
+      fifo.PushTriangle(x, y, z);
+    }
+    else
+    {
+      //bit k of the low nibble: vertex k is simply the next new vertex
+      size_t codePos = out.size();
+      out.push_back(0);
+      unsigned char code = EDGE_NONE << 4;
+      for(unsigned int k = 0; k < 3; k++)
+      {
+        if(tri[k] == next)
+        {
+          code |= 1 << k;
+          next++;
+        }
+        else
+          WriteVarint(out, ZigZag((int)(tri[k] - last)));
+        last = tri[k];
+      }
+      out[codePos] = code;
+      fifo.PushTriangle(tri[0], tri[1], tri[2]);
+    }
+  }
+  return out;
+}
+
+bool DecodeIndexBuffer(unsigned int* destination, unsigned int indexCount, unsigned int vertexCount,
+  const unsigned char* buffer, size_t size)
+{
+  if(indexCount % 3 != 0 || size < 1 || buffer[0] != INDEX_CODEC_VERSION)
+    return false;
+
+  const unsigned char* p = buffer + 1;
+  const unsigned char* end = buffer + size;
+  EdgeFifo fifo;
+  unsigned int next = 0;
+  unsigned int last = 0;
+
+  for(unsigned int i = 0; i < indexCount; i += 3)
+  {
+    if(p == end)
+      return false;
+    const unsigned char code = *p++;
+    const unsigned int edge = code >> 4;
+    unsigned int* tri = destination + i;
+
+    if(edge != EDGE_NONE)
+    {
+      const unsigned int* e = fifo.Get(edge);
+      if(e[0] == ~0u)
+        return false;
+      tri[0] = e[0];
+      tri[1] = e[1];
+      if((code & 1) == 0)
+        tri[2] = next++;
+      else
+      {
+        unsigned int v;
+        if(!ReadVarint(p, end, v))
+          return false;
+        tri[2] = last + (unsigned int)UnZigZag(v);
+      }
+      last = tri[2];
+      if(tri[2] >= vertexCount)
+        return false;
+    }
+    else
+    {
+      for(unsigned int k = 0; k < 3; k++)
+      {
+        if(code & (1 << k))
+          tri[k] = next++;
+        else
+        {
+          unsigned int v;
+          if(!ReadVarint(p, end, v))
+            return false;
+          tri[k] = last + (unsigned int)UnZigZag(v);
+        }
+        last = tri[k];
+        if(tri[k] >= vertexCount)
+          return false;
+      }
+    }
+    fifo.PushTriangle(tri[0], tri[1], tri[2]);
+  }
+  return p == end;
+}
+
+//every byte plane is split into groups of 16 deltas, each group is stored
+//with 0, 2, 4 or 8 bits per value. the 2 bit width selectors of four groups
+//share one header byte.
+static const unsigned int GROUP_SIZE = 16;
+static const unsigned int GROUP_BITS[4] = { 0, 2, 4, 8 };
+
+static unsigned int GroupWidth(const unsigned char* z)
+{
+  unsigned char m = 0;
+  for(unsigned int j = 0; j < GROUP_SIZE; j++)
+    m |= z[j];
+  if(m == 0) return 0;
+  if(m < 4) return 1;
+  if(m < 16) return 2;
+  return 3;
+}
+
+std::vector<unsigned char> EncodeVertexBuffer(const void* vertices, unsigned int vertexCount,
+  unsigned int stride)
+{
+  const unsigned char* data = (const unsigned char*)vertices;
+  const unsigned int groups = (vertexCount + GROUP_SIZE - 1) / GROUP_SIZE;
+  std::vector<unsigned char> out;
+  out.push_back(VERTEX_CODEC_VERSION);
+
+  std::vector<unsigned char> z(groups * GROUP_SIZE, 0);
+  for(unsigned int k = 0; k < stride; k++)
+  {
+    unsigned char prev = 0;
+    for(unsigned int i = 0; i < vertexCount; i++)
+    {
+      unsigned char b = data[(size_t)i * stride + k];
+      //zigzag on the byte as unsigned, the sign sits in bit 7
+      const unsigned int u = (unsigned char)(b - prev);
+      z[i] = (unsigned char)((u << 1) ^ (0u - (u >> 7)));
+      prev = b;
+    }
+
+    size_t header = out.size();
+    out.resize(out.size() + (groups + 3) / 4, 0);
+    for(unsigned int g = 0; g < groups; g++)
+    {
+      const unsigned char* src = &z[g * GROUP_SIZE];
+      unsigned int width = GroupWidth(src);
+      out[header + g / 4] |= (unsigned char)(width << ((g % 4) * 2));
+
+      const unsigned int bits = GROUP_BITS[width];
+      if(bits == 0)
+        continue;
+      const unsigned int perByte = 8 / bits;
+      for(unsigned int j = 0; j < GROUP_SIZE; j += perByte)
+      {
+        unsigned char packed = 0;
+        for(unsigned int s = 0; s < perByte; s++)
+          packed |= (unsigned char)(src[j + s] << (s * bits));
+        out.push_back(packed);
+      }
+    }
+  }
+  return out;
+}
+
+//unpacks one group of 16 zigzagged deltas, returns the number of bytes consumed
+static unsigned int UnpackGroup(const unsigned char* src, unsigned int width, unsigned char* z)
+{
+  switch(width)
+  {
+    case 0:
+      memset(z, 0, GROUP_SIZE);
+      return 0;
+    case 1:
+      for(unsigned int j = 0; j < GROUP_SIZE; j++)
+        z[j] = (src[j / 4] >> ((j % 4) * 2)) & 3;
+      return 4;
+    case 2:
+      for(unsigned int j = 0; j < GROUP_SIZE; j++)
+        z[j] = (src[j / 2] >> ((j % 2) * 4)) & 15;
+      return 8;
+  }
+  memcpy(z, src, GROUP_SIZE);
+  return 16;
+}
+
+#ifdef MESHCODEC_SSE2
+static __m128i UnpackGroupSSE(const unsigned char* src, unsigned int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  switch(width)
+  {
+    case 0:
+      return zero;
+    case 1:
+    {
+      int raw;
+      memcpy(&raw, src, 4);
+      const __m128i x = _mm_cvtsi32_si128(raw);
+      const __m128i m = _mm_set1_epi8(3);
+      __m128i a = _mm_and_si128(x, m);
+      __m128i b = _mm_and_si128(_mm_srli_epi16(x, 2), m);
+      __m128i c = _mm_and_si128(_mm_srli_epi16(x, 4), m);
+      __m128i d = _mm_and_si128(_mm_srli_epi16(x, 6), m);
+      return _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+    }
+    case 2:
+    {
+      const __m128i x = _mm_loadl_epi64((const __m128i*)src);
+      const __m128i m = _mm_set1_epi8(15);
+      __m128i lo = _mm_and_si128(x, m);
+      __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), m);
+      return _mm_unpacklo_epi8(lo, hi);
+    }
+  }
+  return _mm_loadu_si128((const __m128i*)src);
+}
+
+//undoes zigzag and the delta of 16 bytes at once, prev is the last byte of the previous group
+static __m128i DecodeDeltasSSE(__m128i z, unsigned char prev)
+{
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i shifted = _mm_and_si128(_mm_srli_epi16(z, 1), _mm_set1_epi8(0x7f));
+  __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, one));
+  __m128i x = _mm_xor_si128(shifted, sign);
+
+  //inclusive prefix sum over the 16 lanes
+  x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+  x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+  x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+  x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+  return _mm_add_epi8(x, _mm_set1_epi8((char)prev));
+}
+#endif
+
+bool DecodeVertexBuffer(void* destination, unsigned int vertexCount, unsigned int stride,
+  const unsigned char* buffer, size_t size)
+{
+  if(size < 1 || buffer[0] != VERTEX_CODEC_VERSION)
+    return false;
+
+  unsigned char* dst = (unsigned char*)destination;
+  const unsigned char* p = buffer + 1;
+  const unsigned char* end = buffer + size;
+  const unsigned int groups = (vertexCount + GROUP_SIZE - 1) / GROUP_SIZE;
+
+  for(unsigned int k = 0; k < stride; k++)
+  {
+    const unsigned char* header = p;
+    p += (groups + 3) / 4;
+    if(p > end)
+      return false;
+
+    unsigned char prev = 0;
+    for(unsigned int g = 0; g < groups; g++)
+    {
+      const unsigned int width = (header[g / 4] >> ((g % 4) * 2)) & 3;
+      if(p + GROUP_BITS[width] * 2 > end)
+        return false;
+
+      unsigned char values[GROUP_SIZE];
+#ifdef MESHCODEC_SSE2
+      __m128i x = DecodeDeltasSSE(UnpackGroupSSE(p, width), prev);
+      p += GROUP_BITS[width] * 2;
+      _mm_storeu_si128((__m128i*)values, x);
+#else
+      p += UnpackGroup(p, width, values);
+      for(unsigned int j = 0; j < GROUP_SIZE; j++)
+      {
+        const unsigned int zz = values[j];
+        prev = (unsigned char)(prev + ((zz >> 1) ^ (0u - (zz & 1))));
+        values[j] = prev;
+      }
+#endif
+      prev = values[GROUP_SIZE - 1];
+
+      //transpose the plane back into interleaved vertices
+      unsigned int count = vertexCount - g * GROUP_SIZE;
+      if(count > GROUP_SIZE)
+        count = GROUP_SIZE;
+      unsigned char* out = dst + (size_t)g * GROUP_SIZE * stride + k;
+      for(unsigned int j = 0; j < count; j++)
+        out[(size_t)j * stride] = values[j];
+    }
+  }
+  return p == end;
+}
+
+struct MeshFileHeader
+{
+  unsigned int Magic;
+  unsigned int VertexCount;
+  unsigned int Stride;
+  unsigned int IndexCount;
+  unsigned int VertexBytes;
+  unsigned int IndexBytes;
+};
+
+bool SaveMesh(const std::string& filepath, const MeshData& mesh)
+{
+  std::vector<unsigned char> vertices = EncodeVertexBuffer(mesh.Vertices.data(), mesh.VertexCount, mesh.Stride);
+  std::vector<unsigned char> indices = EncodeIndexBuffer(mesh.Indices.data(), (unsigned int)mesh.Indices.size());
+
+  MeshFileHeader header = { MESH_FILE_MAGIC, mesh.VertexCount, mesh.Stride,
+    (unsigned int)mesh.Indices.size(), (unsigned int)vertices.size(), (unsigned int)indices.size() };
+
+  std::ofstream stream(filepath, std::ios::binary);
+  stream.write((const char*)&header, sizeof(header));
+  stream.write((const char*)vertices.data(), vertices.size());
+  stream.write((const char*)indices.data(), indices.size());
+  return stream.good();
+}
+
+bool LoadMesh(const std::string& filepath, MeshData& mesh)
+{
+  std::ifstream stream(filepath, std::ios::binary | std::ios::ate);
+  const long long fileSize = stream ? (long long)stream.tellg() : 0;
+  stream.seekg(0);
+  MeshFileHeader header;
+  if(!stream.read((char*)&header, sizeof(header)) || header.Magic != MESH_FILE_MAGIC)
+  {
+    std::cout << "Invalid mesh file " << filepath << std::endl;
+    return false;
+  }
+
+  //the counts decide how much gets allocated, so they have to fit the compressed sizes:
+  //every byte plane starts with a width byte per 4 groups, every triangle takes at least one byte
+  const unsigned long long groups = ((unsigned long long)header.VertexCount + GROUP_SIZE - 1) / GROUP_SIZE;
+  if((unsigned long long)sizeof(header) + header.VertexBytes + header.IndexBytes != (unsigned long long)fileSize ||
+    header.IndexCount % 3 != 0 || header.IndexCount / 3 > header.IndexBytes ||
+    (header.VertexCount > 0 && header.Stride == 0) ||
+    1ull + (unsigned long long)header.Stride * ((groups + 3) / 4) > header.VertexBytes)
+  {
+    std::cout << "Corrupt mesh file " << filepath << std::endl;
+    return false;
+  }
+
+  //one read for both compressed streams
+  std::vector<unsigned char> blob((size_t)header.VertexBytes + header.IndexBytes);
+  if(!stream.read((char*)blob.data(), blob.size()))
+    return false;
+
+  mesh.VertexCount = header.VertexCount;
+  mesh.Stride = header.Stride;
+  mesh.Vertices.resize((size_t)header.VertexCount * header.Stride);
+  mesh.Indices.resize(header.IndexCount);
+
+  if(!DecodeVertexBuffer(mesh.Vertices.data(), header.VertexCount, header.Stride, blob.data(), header.VertexBytes) ||
+    !DecodeIndexBuffer(mesh.Indices.data(), header.IndexCount, header.VertexCount,
+      blob.data() + header.VertexBytes, header.IndexBytes))
+  {
+    std::cout << "Corrupt mesh file " << filepath << std::endl;
+    return false;
+  }
+  return true;
+}
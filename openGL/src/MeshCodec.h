@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+//decoded mesh, Vertices and Indices can be handed straight to
+//VertexBuffer(Vertices.data(), Vertices.size()) and IndexBuffer(Indices.data(), Indices.size())
+struct MeshData
+{
+  std::vector<unsigned char> Vertices;
+  std::vector<unsigned int> Indices;
+  unsigned int VertexCount;
+  unsigned int Stride;
+};
+
+//triangle list index codec: edge-cache + delta encoding.
+//works best on indices in first-use order (as produced by WeldVertices).
+//decoded triangles keep their winding but may be rotated.
+//decoding fails if any index is vertexCount or above.
+std::vector<unsigned char> EncodeIndexBuffer(const unsigned int* indices, unsigned int indexCount);
+bool DecodeIndexBuffer(unsigned int* destination, unsigned int indexCount, unsigned int vertexCount,
+  const unsigned char* buffer, size_t size);
+
+//vertex codec: per byte-plane delta, zigzag and 0/2/4/8 bit group packing.
+//decoding uses SSE2 when available.
+std::vector<unsigned char> EncodeVertexBuffer(const void* vertices, unsigned int vertexCount,
+  unsigned int stride);
+bool DecodeVertexBuffer(void* destination, unsigned int vertexCount, unsigned int stride,
+  const unsigned char* buffer, size_t size);
+
+bool SaveMesh(const std::string& filepath, const MeshData& mesh);
+//rejects files whose sizes don't add up or whose indices point past the vertices
+bool LoadMesh(const std::string& filepath, MeshData& mesh);
@@ -0,0 +1,140 @@
+#include "ProgramBinaryCache.h"
+#include "Renderer.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static const unsigned int BINARY_FILE_MAGIC = 0x4e494250; //"PBIN"
+
+struct BinaryFileHeader
+{
+  unsigned int Magic;
+  unsigned int Format;
+  unsigned int Length;
+  unsigned long long Key; //guards against a file renamed into the wrong slot
+};
+
+static unsigned long long HashBytes(unsigned long long h, const void* data, size_t size)
+{
+  //FNV-1a 64
+  const unsigned char* p = (const unsigned char*)data;
+  for(size_t i = 0; i < size; i++)
+    h = (h ^ p[i]) * 1099511628211ull;
+  return h;
+}
+
+static unsigned long long HashString(unsigned long long h, const char* s)
+{
+  if(!s)
+    return h;
+  //include the terminator so "ab"+"c" and "a"+"bc" differ
+  return HashBytes(h, s, strlen(s) + 1);
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+  : m_Directory(directory), m_DriverHash(14695981039346656037ull), m_Supported(false)
+{
+  int formats = 0;
+  if(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+  {
+    GLCALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+  }
+  m_Supported = formats > 0;
+
+  m_DriverHash = HashString(m_DriverHash, (const char*)glGetString(GL_VENDOR));
+  m_DriverHash = HashString(m_DriverHash, (const char*)glGetString(GL_RENDERER));
+  m_DriverHash = HashString(m_DriverHash, (const char*)glGetString(GL_VERSION));
+
+  if(m_Supported)
+  {
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+    if(error)
+    {
+      std::cout << "Program cache disabled, cannot create " << m_Directory << std::endl;
+      m_Supported = false;
+    }
+  }
+}
+
+std::string ProgramBinaryCache::GetPath(unsigned long long key) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", key);
+  return m_Directory + "/" + name;
+}
+
+unsigned long long ProgramBinaryCache::ComputeKey(const char* const* sources, const int* lengths,
+  unsigned int count) const
+{
+  unsigned long long h = m_DriverHash;
+  for(unsigned int i = 0; i < count; i++)
+  {
+    unsigned long long length = lengths[i];
+    h = HashBytes(h, &length, sizeof(length));
+    h = HashBytes(h, sources[i], lengths[i]);
+  }
+  return h;
+}
+
+unsigned int ProgramBinaryCache::Load(unsigned long long key) const
+{
+  if(!m_Supported)
+    return 0;
+
+  std::ifstream stream(GetPath(key), std::ios::binary);
+  BinaryFileHeader header;
+  if(!stream.read((char*)&header, sizeof(header)) || header.Magic != BINARY_FILE_MAGIC || header.Key != key)
+    return 0;
+
+  std::vector<char> binary(header.Length);
+  if(!stream.read(binary.data(), binary.size()))
+    return 0;
+
+  unsigned int program = glCreateProgram();
+  //an unknown or stale format raises GL_INVALID_ENUM, which is no reason to break into the
+  //debugger: the error is dropped and the link status below sends us back to the sources.
+  //the driver may also reject binaries from another version even when the strings match
+  GLClearError();
+  glProgramBinary(program, header.Format, binary.data(), (int)binary.size());
+  GLClearError();
+  int linked = GL_FALSE;
+  GLCALL(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+  if(linked == GL_FALSE)
+  {
+    GLCALL(glDeleteProgram(program));
+    return 0;
+  }
+  return program;
+}
+
+void ProgramBinaryCache::Store(unsigned long long key, unsigned int program) const
+{
+  if(!m_Supported)
+    return;
+
+  int length = 0;
+  GLCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+  if(length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  unsigned int format = 0;
+  GLCALL(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+  BinaryFileHeader header = { BINARY_FILE_MAGIC, format, (unsigned int)length, key };
+  const std::string path = GetPath(key);
+  {
+    std::ofstream stream(path + ".tmp", std::ios::binary);
+    stream.write((const char*)&header, sizeof(header));
+    stream.write(binary.data(), length);
+    if(!stream.good())
+      return;
+  }
+  //rename last so a crash never leaves a half written entry behind
+  std::error_code error;
+  std::filesystem::rename(path + ".tmp", path, error);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+
+//stores linked programs on disk with glGetProgramBinary and restores them with
+//glProgramBinary. the key covers the final shader sources and the driver's
+//vendor/renderer/version strings, so a driver update simply misses the cache.
+class ProgramBinaryCache
+{
+private:
+  std::string m_Directory;
+  unsigned long long m_DriverHash;
+  bool m_Supported;
+
+  std::string GetPath(unsigned long long key) const;
+
+public:
+  //needs a current GL context
+  ProgramBinaryCache(const std::string& directory);
+
+  //sources/lengths in the form handed to glShaderSource
+  unsigned long long ComputeKey(const char* const* sources, const int* lengths, unsigned int count) const;
+
+  //returns a linked program, or 0 when there is no usable entry
+  unsigned int Load(unsigned long long key) const;
+  //program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+  void Store(unsigned long long key, unsigned int program) const;
+
+  inline bool IsSupported () const {return m_Supported;}
+};
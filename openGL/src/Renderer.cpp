@@ -1,5 +1,13 @@
 #include "Renderer.h"
 #include <iostream>
+#include "VertexArray.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "UniformBuffer.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+#include "ShaderReflection.h"
+#include <cstring>
 
 void GLClearError()
 {
@@ -17,4 +25,386 @@ bool GLLogCall(const char* function, const char* file, const int line)
         return false;
     }
     return true;
-}
\ No newline at end of file
+}
+
+const char* const Renderer::INSTANCE_BLOCK = "Instances";
+
+Renderer::Renderer()
+    : m_IndirectBuffer(0), m_IndirectCapacity(0), m_InstanceBuffer(0), m_InstanceCapacity(0),
+      m_MultiDrawEnabled(true)
+{
+    int alignment = 0;
+    GLCALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+    m_InstanceAlignment = alignment > 0 && (alignment & (alignment - 1)) == 0 ? alignment : 256;
+}
+
+Renderer::~Renderer()
+{
+    if(m_IndirectBuffer)
+    {
+        GLCALL(glDeleteBuffers(1, &m_IndirectBuffer));
+    }
+    if(m_InstanceBuffer)
+    {
+        GLCALL(glDeleteBuffers(1, &m_InstanceBuffer));
+    }
+}
+
+bool Renderer::IsMultiDrawSupported()
+{
+    return GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+}
+
+void Renderer::AttachDrawIds(VertexArray& va, const ShaderReflection& reflection)
+{
+    if(!m_DrawIds)
+    {
+        std::vector<unsigned int> ids(MAX_DRAW_IDS);
+        for(unsigned int i = 0; i < MAX_DRAW_IDS; i++)
+            ids[i] = i;
+        m_DrawIds.reset(new VertexBuffer(ids.data(), MAX_DRAW_IDS * sizeof(unsigned int)));
+    }
+    const ShaderReflection::Attribute* attribute = reflection.FindAttribute("a_DrawId");
+    if(!attribute)
+        return;
+    //matched against a_DrawId alone, the other inputs are up to the mesh streams
+    ShaderReflection drawId;
+    drawId.Attributes.push_back(*attribute);
+    VertexBufferLayout layout;
+    layout.Push<unsigned int>(1, "a_DrawId");
+    va.AddBuffer(*m_DrawIds, layout, drawId, 1);
+}
+
+void Renderer::Clear() const
+{
+    GLCALL(glClear(GL_COLOR_BUFFER_BIT));
+}
+
+void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const
+{
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCALL(glDrawElements(ib.GetTopology(), ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+}
+
+void Renderer::DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+    unsigned int instanceCount) const
+{
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCALL(glDrawElementsInstanced(ib.GetTopology(), ib.GetCount(), GL_UNSIGNED_INT, nullptr, instanceCount));
+}
+
+//layer:4 | shader:12 | vertex array:12 | index buffer:8 | material:12 | depth:16, high bits sort first.
+//the ids are truncated gl names, two objects sharing bits only costs an extra bind.
+//the index buffer sits above depth so packets drawing from one buffer stay together for the runs
+unsigned long long Renderer::MakeSortKey(const DrawPacket& packet)
+{
+    ASSERT(packet.layer < 16);
+    const unsigned long long shader = packet.shader->GetRendererId() & 0xfff;
+    const unsigned long long va = packet.va->GetRendererId() & 0xfff;
+    const unsigned long long ib = packet.ib->GetRendererId() & 0xff;
+    //offsets are multiples of the ubo alignment, spread them before truncating
+    const unsigned long long material = packet.material.size == 0 ? 0 :
+        ((packet.material.offset * 2654435761u) >> 20) & 0xfff;
+
+    //the bits of a non negative float sort like the float. the sign is always clear and
+    //dropped, bits 15-30 keep the 8 exponent bits and the top 8 mantissa bits, so depths
+    //about 0.4% (1/256) apart still sort apart
+    float depth = packet.depth > 0.0f ? packet.depth : 0.0f;
+    unsigned int bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    const unsigned long long depthBits = (bits >> 15) & 0xffff;
+
+    return ((unsigned long long)packet.layer << 60) | (shader << 48) | (va << 36) | (ib << 28) |
+        (material << 16) | depthBits;
+}
+
+void Renderer::SortQueue()
+{
+    //lsd radix sort, 8 bits per pass. all histograms are counted in one go,
+    //and passes where every key has the same byte are skipped
+    const unsigned int count = (unsigned int)m_Queue.size();
+    unsigned int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for(unsigned int i = 0; i < count; i++)
+    {
+        const unsigned long long key = m_Queue[i].key;
+        for(unsigned int pass = 0; pass < 8; pass++)
+            histograms[pass][(key >> (pass * 8)) & 0xff]++;
+    }
+
+    m_Scratch.resize(count);
+    for(unsigned int pass = 0; pass < 8; pass++)
+    {
+        unsigned int* histogram = histograms[pass];
+        if(histogram[(m_Queue[0].key >> (pass * 8)) & 0xff] == count)
+            continue;
+
+        unsigned int sum = 0;
+        for(unsigned int b = 0; b < 256; b++)
+        {
+            const unsigned int n = histogram[b];
+            histogram[b] = sum;
+            sum += n;
+        }
+        for(unsigned int i = 0; i < count; i++)
+        {
+            const SortEntry& entry = m_Queue[i];
+            m_Scratch[histogram[(entry.key >> (pass * 8)) & 0xff]++] = entry;
+        }
+        m_Queue.swap(m_Scratch);
+    }
+}
+
+void Renderer::Submit(const DrawPacket& packet)
+{
+    //the a_DrawId stream has MAX_DRAW_IDS entries, an instance past it reads beyond the buffer
+    ASSERT(packet.instanceIndex < MAX_DRAW_IDS);
+    m_Packets.push_back(packet);
+}
+
+void Renderer::Submit(const DrawPacket* packets, const std::vector<unsigned int>& visible)
+{
+    m_Packets.reserve(m_Packets.size() + visible.size());
+    for(unsigned int i = 0; i < visible.size(); i++)
+    {
+        ASSERT(packets[visible[i]].instanceIndex < MAX_DRAW_IDS);
+        m_Packets.push_back(packets[visible[i]]);
+    }
+}
+
+static bool SameState(const DrawPacket& a, const DrawPacket& b)
+{
+    return a.shader == b.shader && a.va == b.va && a.ib == b.ib &&
+        a.material.offset == b.material.offset && a.material.size == b.material.size;
+}
+
+static bool SameRange(const DrawPacket& a, const DrawPacket& b)
+{
+    return a.firstIndex == b.firstIndex && a.indexCount == b.indexCount && a.baseVertex == b.baseVertex;
+}
+
+unsigned int Renderer::FindInstanceRun(unsigned int begin, unsigned int maxInstances) const
+{
+    const DrawPacket& first = m_Packets[m_Queue[begin].index];
+    unsigned int end = begin + 1;
+    while(end < m_Queue.size() && end - begin < maxInstances)
+    {
+        const DrawPacket& packet = m_Packets[m_Queue[end].index];
+        if(packet.object.size != first.object.size || !SameState(first, packet) || !SameRange(first, packet))
+            break;
+        end++;
+    }
+    return end;
+}
+
+void Renderer::BuildRuns(const UniformBuffer* uniforms)
+{
+    m_Runs.clear();
+    m_Commands.clear();
+    m_InstanceData.clear();
+    const bool multiDraw = m_MultiDrawEnabled && IsMultiDrawSupported();
+    const unsigned int count = (unsigned int)m_Queue.size();
+    //every instanced run binds a whole block, the buffer has to reach past the last one
+    unsigned int instanceEnd = 0;
+
+    for(unsigned int begin = 0; begin < count;)
+    {
+        const DrawPacket& first = m_Packets[m_Queue[begin].index];
+        DrawRun run = { begin, begin + 1, NO_COMMAND, 0, NO_COMMAND };
+        const ShaderReflection::Block* instances = uniforms && first.object.size != 0 ?
+            first.shader->GetReflection().FindBlock(INSTANCE_BLOCK) : nullptr;
+
+        if(instances)
+        {
+            //the std140 array stride of a struct is its size rounded up to a vec4
+            const unsigned int stride = (first.object.size + 15) & ~15u;
+            //the block holds nothing but the array, so its size is a whole number of elements
+            ASSERT(stride <= instances->size && instances->size % stride == 0);
+            run.end = FindInstanceRun(begin, instances->size / stride);
+            run.instanceOffset = ((unsigned int)m_InstanceData.size() + m_InstanceAlignment - 1) & ~(m_InstanceAlignment - 1);
+            m_InstanceData.resize(run.instanceOffset + (run.end - begin) * stride, 0);
+            for(unsigned int i = begin; i < run.end; i++)
+            {
+                const DrawPacket& packet = m_Packets[m_Queue[i].index];
+                memcpy(&m_InstanceData[run.instanceOffset + (i - begin) * stride],
+                    uniforms->GetData(packet.object), packet.object.size);
+            }
+            if(run.instanceOffset + instances->size > instanceEnd)
+                instanceEnd = run.instanceOffset + instances->size;
+        }
+        else if(multiDraw && first.object.size == 0)
+        {
+            while(run.end < count)
+            {
+                const DrawPacket& packet = m_Packets[m_Queue[run.end].index];
+                if(packet.object.size != 0 || !SameState(first, packet))
+                    break;
+                run.end++;
+            }
+        }
+
+        if(!instances && run.end - begin > 1)
+        {
+            run.command = (unsigned int)m_Commands.size();
+            for(unsigned int i = begin; i < run.end; i++)
+            {
+                const DrawPacket& packet = m_Packets[m_Queue[i].index];
+                const unsigned int indexCount = packet.indexCount ? packet.indexCount : packet.ib->GetCount();
+                //the same range with the next instanceIndex only adds an instance
+                if(m_Commands.size() > run.command)
+                {
+                    DrawElementsIndirectCommand& last = m_Commands.back();
+                    if(last.count == indexCount && last.firstIndex == packet.firstIndex &&
+                        last.baseVertex == packet.baseVertex &&
+                        last.baseInstance + last.instanceCount == packet.instanceIndex)
+                    {
+                        last.instanceCount++;
+                        continue;
+                    }
+                }
+                DrawElementsIndirectCommand command = {
+                    indexCount, 1, packet.firstIndex, packet.baseVertex, packet.instanceIndex };
+                m_Commands.push_back(command);
+            }
+            run.commandCount = (unsigned int)m_Commands.size() - run.command;
+        }
+        m_Runs.push_back(run);
+        begin = run.end;
+    }
+
+    if(instanceEnd > m_InstanceData.size())
+        m_InstanceData.resize(instanceEnd, 0);
+}
+
+void Renderer::UploadCommands()
+{
+    const unsigned int size = (unsigned int)(m_Commands.size() * sizeof(DrawElementsIndirectCommand));
+    if(!m_IndirectBuffer)
+    {
+        GLCALL(glGenBuffers(1, &m_IndirectBuffer));
+    }
+    GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer));
+    while(m_IndirectCapacity < size)
+        m_IndirectCapacity = m_IndirectCapacity ? m_IndirectCapacity * 2 : 4096;
+    //orphan, the previous frame's commands may still be read
+    GLCALL(glBufferData(GL_DRAW_INDIRECT_BUFFER, m_IndirectCapacity, nullptr, GL_STREAM_DRAW));
+    GLCALL(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, m_Commands.data()));
+}
+
+void Renderer::UploadInstances()
+{
+    const unsigned int size = (unsigned int)m_InstanceData.size();
+    if(!m_InstanceBuffer)
+    {
+        GLCALL(glGenBuffers(1, &m_InstanceBuffer));
+    }
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, m_InstanceBuffer));
+    while(m_InstanceCapacity < size)
+        m_InstanceCapacity = m_InstanceCapacity ? m_InstanceCapacity * 2 : 65536;
+    GLCALL(glBufferData(GL_UNIFORM_BUFFER, m_InstanceCapacity, nullptr, GL_STREAM_DRAW));
+    GLCALL(glBufferSubData(GL_UNIFORM_BUFFER, 0, size, m_InstanceData.data()));
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+void Renderer::Flush(const UniformBuffer* uniforms)
+{
+    if(m_Packets.empty())
+        return;
+
+    m_Queue.resize(m_Packets.size());
+    for(unsigned int i = 0; i < m_Packets.size(); i++)
+    {
+        m_Queue[i].key = MakeSortKey(m_Packets[i]);
+        m_Queue[i].index = i;
+    }
+    SortQueue();
+    BuildRuns(uniforms);
+    if(!m_Commands.empty())
+        UploadCommands();
+    if(!m_InstanceData.empty())
+        UploadInstances();
+
+    const bool baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+    const Shader* shader = nullptr;
+    const VertexArray* va = nullptr;
+    const IndexBuffer* ib = nullptr;
+    unsigned int material = 0xffffffff;
+    for(unsigned int r = 0; r < m_Runs.size(); r++)
+    {
+        const DrawRun& run = m_Runs[r];
+        //every packet of a run shares the state, bind it once
+        const DrawPacket& packet = m_Packets[m_Queue[run.begin].index];
+        if(packet.shader != shader)
+        {
+            packet.shader->Bind();
+            shader = packet.shader;
+        }
+        if(packet.va != va)
+        {
+            packet.va->Bind();
+            va = packet.va;
+            ib = nullptr; //the element buffer binding belongs to the vertex array
+        }
+        if(packet.ib != ib)
+        {
+            packet.ib->Bind();
+            ib = packet.ib;
+        }
+        if(uniforms && packet.material.size != 0 && packet.material.offset != material)
+        {
+            uniforms->BindRange(MATERIAL_BINDING, packet.material);
+            material = packet.material.offset;
+        }
+
+        if(run.command != NO_COMMAND)
+        {
+            GLCALL(glMultiDrawElementsIndirect(ib->GetTopology(), GL_UNSIGNED_INT,
+                (const void*)(run.command * sizeof(DrawElementsIndirectCommand)), run.commandCount, 0));
+            continue;
+        }
+
+        const unsigned int count = packet.indexCount ? packet.indexCount : ib->GetCount();
+        //glew declares the BaseVertex offset non-const
+        void* offset = (void*)(packet.firstIndex * sizeof(unsigned int));
+        if(run.instanceOffset != NO_COMMAND)
+        {
+            const unsigned int blockSize = packet.shader->GetReflection().FindBlock(INSTANCE_BLOCK)->size;
+            GLCALL(glBindBufferRange(GL_UNIFORM_BUFFER, INSTANCE_BINDING, m_InstanceBuffer, run.instanceOffset, blockSize));
+            //the draw id stream starts at the first packet's instanceIndex, like in single draws
+            if(baseInstance)
+            {
+                GLCALL(glDrawElementsInstancedBaseVertexBaseInstance(ib->GetTopology(), count, GL_UNSIGNED_INT,
+                    offset, run.end - run.begin, packet.baseVertex, packet.instanceIndex));
+            }
+            else
+            {
+                GLCALL(glDrawElementsInstancedBaseVertex(ib->GetTopology(), count, GL_UNSIGNED_INT, offset,
+                    run.end - run.begin, packet.baseVertex));
+            }
+            continue;
+        }
+
+        if(uniforms && packet.object.size != 0)
+            uniforms->BindRange(OBJECT_BINDING, packet.object);
+        if(baseInstance)
+        {
+            GLCALL(glDrawElementsInstancedBaseVertexBaseInstance(ib->GetTopology(), count, GL_UNSIGNED_INT,
+                offset, 1, packet.baseVertex, packet.instanceIndex));
+        }
+        else
+        {
+            //without base instances a draw id stream always reads 0
+            GLCALL(glDrawElementsBaseVertex(ib->GetTopology(), count, GL_UNSIGNED_INT, offset, packet.baseVertex));
+        }
+    }
+
+    if(!m_Commands.empty())
+    {
+        GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+    }
+    m_Packets.clear();
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <memory>
+#include <vector>
 #include <glew.h>
 
 
@@ -10,3 +12,147 @@
 void GLClearError();
 
 bool GLLogCall(const char* function, const char* file, const int line);
+
+class VertexArray;
+class IndexBuffer;
+class Shader;
+class UniformBuffer;
+class VertexBuffer;
+struct ShaderReflection;
+
+//part of a UniformBuffer handed out by UniformBuffer::Allocate
+struct UniformBlockRange
+{
+  unsigned int offset;
+  unsigned int size;
+};
+
+//everything needed for one draw, collected with Renderer::Submit
+struct DrawPacket
+{
+  const VertexArray* va;
+  const IndexBuffer* ib;
+  const Shader* shader;
+  //blocks of the UniformBuffer handed to Flush, size 0 = nothing to bind
+  UniformBlockRange material;
+  UniformBlockRange object;
+  //view depth, draws of the same state go front to back
+  float depth;
+  //layers are drawn in increasing order, whatever their state
+  unsigned char layer;
+  //sub-range of the index buffer, indexCount 0 draws all of it
+  unsigned int firstIndex;
+  unsigned int indexCount;
+  int baseVertex;
+  //per-draw data index handed to the shader as the base instance,
+  //read through the stream from Renderer::AttachDrawIds (or gl_BaseInstanceARB)
+  unsigned int instanceIndex;
+};
+
+//layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+  unsigned int count;
+  unsigned int instanceCount;
+  unsigned int firstIndex;
+  int baseVertex;
+  unsigned int baseInstance;
+};
+
+class Renderer
+{
+private:
+  struct SortEntry
+  {
+    unsigned long long key;
+    unsigned int index;
+  };
+
+  //consecutive sorted packets issued together, command is the first
+  //indirect command of a multi-draw or NO_COMMAND for a single draw.
+  //instanced runs have their object blocks gathered at instanceOffset
+  struct DrawRun
+  {
+    unsigned int begin;
+    unsigned int end;
+    unsigned int command;
+    unsigned int commandCount;
+    unsigned int instanceOffset;
+  };
+  static const unsigned int NO_COMMAND = 0xffffffff;
+
+  std::vector<DrawPacket> m_Packets;
+  std::vector<SortEntry> m_Queue;
+  std::vector<SortEntry> m_Scratch;
+  std::vector<DrawRun> m_Runs;
+  std::vector<DrawElementsIndirectCommand> m_Commands;
+  unsigned int m_IndirectBuffer;
+  unsigned int m_IndirectCapacity;
+  //object blocks of instanced runs, back to back as the std140 array of the Instances block
+  std::vector<unsigned char> m_InstanceData;
+  unsigned int m_InstanceBuffer;
+  unsigned int m_InstanceCapacity;
+  unsigned int m_InstanceAlignment;
+  bool m_MultiDrawEnabled;
+  //0, 1, 2, ... fed per instance, so with a base instance each draw reads its instanceIndex
+  std::unique_ptr<VertexBuffer> m_DrawIds;
+
+  static unsigned long long MakeSortKey(const DrawPacket& packet);
+  void SortQueue();
+  //splits the sorted queue into runs, fills m_Commands and gathers instance data
+  void BuildRuns(const UniformBuffer* uniforms);
+  //how many packets from begin on can become instances of one draw
+  unsigned int FindInstanceRun(unsigned int begin, unsigned int maxInstances) const;
+  void UploadCommands();
+  void UploadInstances();
+
+public:
+  //binding points the Frame, Material and Object blocks of the shaders are assigned to
+  static const unsigned int FRAME_BINDING = 0;
+  static const unsigned int MATERIAL_BINDING = 1;
+  static const unsigned int OBJECT_BINDING = 2;
+  //shaders declaring this block get their repeated draws instanced: the object blocks of
+  //draws that only differ in them are gathered into "uniform Instances { Object u_Objects[N]; }"
+  //bound here, indexed by gl_InstanceID, and drawn with one glDrawElementsInstanced.
+  //the block must hold only that array. a_DrawId reads the first packet's instanceIndex
+  //+ gl_InstanceID (just gl_InstanceID without base instances), use u_Objects for per-draw data
+  static const unsigned int INSTANCE_BINDING = 3;
+  static const char* const INSTANCE_BLOCK;
+
+  //highest instanceIndex + 1 the draw id stream covers
+  static const unsigned int MAX_DRAW_IDS = 65536;
+
+  Renderer();
+  ~Renderer();
+
+  Renderer(const Renderer&) = delete;
+  Renderer& operator=(const Renderer&) = delete;
+
+  //GL 4.3 or ARB_multi_draw_indirect
+  static bool IsMultiDrawSupported();
+  //draws sharing vertex array, index buffer, shader and material go out as one
+  //glMultiDrawElementsIndirect when supported, on by default
+  inline void SetMultiDrawEnabled(bool enabled) {m_MultiDrawEnabled = enabled;}
+
+  //adds the per-instance "a_DrawId" stream to va, the shader reads a packet's
+  //instanceIndex from it in single and multi draws alike. the renderer must outlive va.
+  //attach it before the mesh streams, their AddBuffer then sees a_DrawId fed
+  void AttachDrawIds(VertexArray& va, const ShaderReflection& reflection);
+
+  //queues a draw for the next Flush
+  void Submit(const DrawPacket& packet);
+  //queues packets[visible[i]] for every entry, e.g. the survivors of FrustumCuller::Cull
+  void Submit(const DrawPacket* packets, const std::vector<unsigned int>& visible);
+  //sorts the queued draws by state and issues them, binding only what changed
+  //between neighbours. uniforms holds the material / object blocks of the packets.
+  //packets with an object block are instanced when their shader has an INSTANCE_BLOCK,
+  //otherwise they are drawn one by one since the block can't change inside a multi-draw
+  void Flush(const UniformBuffer* uniforms = nullptr);
+  inline unsigned int GetQueuedCount () const {return (unsigned int)m_Packets.size();}
+
+  void Clear() const;
+  void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
+  //one call for instanceCount copies, per-instance streams come from VertexArray::AddBuffer divisors
+  void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+    unsigned int instanceCount) const;
+};
@@ -0,0 +1,443 @@
+#include "Shader.h"
+#include "Renderer.h"
+#include "ProgramBinaryCache.h"
+#include <iostream>
+#include <cstring>
+
+static unsigned int HashName(const char* name)
+{
+  //FNV-1a
+  unsigned int h = 2166136261u;
+  while(*name)
+    h = (h ^ (unsigned char)*name++) * 16777619u;
+  return h;
+}
+
+ProgramBinaryCache* Shader::s_BinaryCache = nullptr;
+const Shader* Shader::s_Fallback = nullptr;
+
+Shader::Shader(const std::string& filepath, bool async)
+  : m_FilePath(filepath), m_RendererId(0), m_Status(Status::COMPILING), m_CacheKey(0), m_UniformCount(0)
+{
+  //the parsed slices are only needed until glShaderSource has copied them
+  Init(ParseShader(filepath), async);
+}
+
+Shader::Shader(const std::string& filepath, const ShaderProgramSource& source, bool async)
+  : m_FilePath(filepath), m_RendererId(0), m_Status(Status::COMPILING), m_CacheKey(0), m_UniformCount(0)
+{
+  Init(source, async);
+}
+
+void Shader::Init(const ShaderProgramSource& source, bool async)
+{
+  for(unsigned int i = 0; i < (unsigned int)ShaderStage::COUNT; i++)
+    m_PendingShaders[i] = 0;
+  for(unsigned int i = 0; i < source.Files.size(); i++)
+    m_Dependencies.push_back(source.Files[i]->GetPath());
+
+  CreateShader(source);
+  if(!async)
+    FinishShader();
+}
+
+void Shader::Reload(const ShaderProgramSource& source)
+{
+  //a newer edit replaces a build that is still in flight
+  m_Replacement.reset(new Shader(m_FilePath, source, true));
+}
+
+bool Shader::PollReload(bool* applied)
+{
+  if(applied)
+    *applied = false;
+  if(!m_Replacement)
+    return true;
+  if(!m_Replacement->Poll())
+    return false;
+
+  if(m_Replacement->IsReady())
+  {
+    //the render loop picks the new handle up on its next Bind(),
+    //the replacement object takes the old program with it
+    std::swap(m_RendererId, m_Replacement->m_RendererId);
+    m_Uniforms.swap(m_Replacement->m_Uniforms);
+    std::swap(m_UniformCount, m_Replacement->m_UniformCount);
+    std::swap(m_Reflection, m_Replacement->m_Reflection);
+    m_Dependencies.swap(m_Replacement->m_Dependencies);
+    m_Status = Status::READY;
+    ApplyBlockBindings();
+    if(applied)
+      *applied = true;
+  }
+  else
+    std::cout << "Keeping the previous program of " << m_FilePath << std::endl;
+  m_Replacement.reset();
+  return true;
+}
+
+Shader::~Shader()
+{
+  for(unsigned int i = 0; i < (unsigned int)ShaderStage::COUNT; i++)
+  {
+    if(m_PendingShaders[i])
+    {
+      GLCALL(glDeleteShader(m_PendingShaders[i]));
+    }
+  }
+  GLCALL(glDeleteProgram(m_RendererId));
+}
+
+//strings are actual source code of the shaders
+
+unsigned int Shader::CompileShader(unsigned int type, const std::vector<std::string_view>& source )
+{
+  unsigned int id = glCreateShader(type);
+  //every slice is passed with its length, GL concatenates them
+  std::vector<const char*> strings(source.size());
+  std::vector<int> lengths(source.size());
+  for(unsigned int i = 0; i < source.size(); i++)
+  {
+    strings[i] = source[i].data();
+    lengths[i] = (int)source[i].size();
+  }
+  glShaderSource(id, (int)source.size(), strings.data(), lengths.data());
+  //querying GL_COMPILE_STATUS here would make the driver finish the compile,
+  //errors are read back in FinishShader()
+  glCompileShader(id);
+  return id;
+}
+
+static bool CheckCompileStatus(unsigned int id)
+{
+  int result;
+  glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+  //error handling
+  if(result==GL_FALSE)
+  {
+    int type;
+    glGetShaderiv(id, GL_SHADER_TYPE, &type);
+    int length;
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    char* message = (char *)alloca((length + 1) * sizeof(char));
+    message[0] = '\0';
+    glGetShaderInfoLog(id, length, &length, message);
+    std::cout << "Failed to compile ";
+    for(int i = 0; i < (int)ShaderStage::COUNT; i++)
+    {
+      if(GetShaderStageType((ShaderStage)i) == (unsigned int)type)
+        std::cout << GetShaderStageName((ShaderStage)i);
+    }
+    std::cout << std::endl;
+    std::cout << message << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static bool CheckLinkStatus(unsigned int program)
+{
+  int result;
+  glGetProgramiv(program, GL_LINK_STATUS, &result);
+  if(result == GL_FALSE)
+  {
+    int length;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    char* message = (char *)alloca((length + 1) * sizeof(char));
+    message[0] = '\0';
+    glGetProgramInfoLog(program, length, &length, message);
+    std::cout << "Failed to link program" << std::endl;
+    std::cout << message << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Shader::CreateShader(const ShaderProgramSource& source)
+{
+  //a warm start skips compiling and linking entirely
+  if(s_BinaryCache && s_BinaryCache->IsSupported())
+  {
+    //each stage is prefixed with its name so moving code between stages changes the key
+    std::vector<const char*> strings;
+    std::vector<int> lengths;
+    for(int i = 0; i < (int)ShaderStage::COUNT; i++)
+    {
+      const std::vector<std::string_view>& slices = source.Stages[i];
+      if(slices.empty())
+        continue;
+      const char* name = GetShaderStageName((ShaderStage)i);
+      strings.push_back(name);
+      lengths.push_back((int)strlen(name));
+      for(unsigned int k = 0; k < slices.size(); k++)
+      {
+        strings.push_back(slices[k].data());
+        lengths.push_back((int)slices[k].size());
+      }
+    }
+    m_CacheKey = s_BinaryCache->ComputeKey(strings.data(), lengths.data(), (unsigned int)strings.size());
+    m_RendererId = s_BinaryCache->Load(m_CacheKey);
+    if(m_RendererId)
+    {
+      m_CacheKey = 0; //nothing to store
+      return;
+    }
+  }
+
+  unsigned int program = glCreateProgram();
+  for(int i = 0; i < (int)ShaderStage::COUNT; i++)
+  {
+    if(source.Stages[i].empty())
+      continue;
+    m_PendingShaders[i] = CompileShader(GetShaderStageType((ShaderStage)i), source.Stages[i]);
+    glAttachShader(program, m_PendingShaders[i]);
+  }
+
+  if(m_CacheKey)
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  //linking is queued behind the compiles, nothing here waits for the driver
+  glLinkProgram(program);
+
+  m_RendererId = program;
+}
+
+bool Shader::Poll()
+{
+  if(m_Status != Status::COMPILING)
+    return true;
+
+  if(GLEW_KHR_parallel_shader_compile)
+  {
+    int done = GL_FALSE;
+    GLCALL(glGetProgramiv(m_RendererId, GL_COMPLETION_STATUS_KHR, &done));
+    if(done == GL_FALSE)
+      return false;
+  }
+  FinishShader();
+  return true;
+}
+
+void Shader::FinishShader()
+{
+  bool compiled = true;
+  for(unsigned int i = 0; i < (unsigned int)ShaderStage::COUNT; i++)
+  {
+    if(!m_PendingShaders[i])
+      continue;
+    compiled = CheckCompileStatus(m_PendingShaders[i]) && compiled;
+    glDetachShader(m_RendererId, m_PendingShaders[i]);
+    glDeleteShader(m_PendingShaders[i]);
+    m_PendingShaders[i] = 0;
+  }
+
+  if(!compiled || !CheckLinkStatus(m_RendererId))
+  {
+    std::cout << "Shader " << m_FilePath << " failed to build" << std::endl;
+    m_Status = Status::FAILED;
+    return;
+  }
+
+  if(m_CacheKey)
+    s_BinaryCache->Store(m_CacheKey, m_RendererId);
+  m_Reflection = ShaderReflection::Reflect(m_RendererId);
+  BuildUniformTable();
+  m_Status = Status::READY;
+  ApplyBlockBindings();
+}
+
+void Shader::BuildUniformTable()
+{
+  const std::vector<ShaderReflection::Uniform>& uniforms = m_Reflection.Uniforms;
+
+  //power of two, at most half full so probes stay short even with misses inserted later
+  unsigned int capacity = 16;
+  while(capacity < (unsigned int)uniforms.size() * 2)
+    capacity <<= 1;
+  m_Uniforms.assign(capacity, UniformSlot());
+  for(unsigned int i = 0; i < capacity; i++)
+    m_Uniforms[i].location = -2; //empty
+  m_UniformCount = 0;
+
+  for(unsigned int i = 0; i < uniforms.size(); i++)
+  {
+    //members of uniform blocks have no location
+    if(uniforms[i].location != -1)
+      InsertUniform(uniforms[i].name.c_str(), HashName(uniforms[i].name.c_str()), uniforms[i].location);
+  }
+}
+
+Shader::UniformSlot* Shader::InsertUniform(const char* name, unsigned int hash, int location)
+{
+  if((m_UniformCount + 1) * 2 > m_Uniforms.size())
+  {
+    std::vector<UniformSlot> old;
+    old.swap(m_Uniforms);
+    m_Uniforms.assign(old.size() * 2, UniformSlot());
+    for(unsigned int i = 0; i < m_Uniforms.size(); i++)
+      m_Uniforms[i].location = -2;
+    m_UniformCount = 0;
+    for(unsigned int i = 0; i < old.size(); i++)
+    {
+      if(old[i].location != -2)
+        *InsertUniform(old[i].name.c_str(), old[i].hash, old[i].location) = old[i];
+    }
+  }
+
+  const unsigned int mask = (unsigned int)m_Uniforms.size() - 1;
+  unsigned int index = hash & mask;
+  while(m_Uniforms[index].location != -2)
+    index = (index + 1) & mask;
+
+  UniformSlot& slot = m_Uniforms[index];
+  slot.name = name;
+  slot.hash = hash;
+  slot.location = location;
+  slot.size = 0;
+  m_UniformCount++;
+  return &slot;
+}
+
+Shader::UniformSlot* Shader::FindUniform(const char* name)
+{
+  ASSERT(!m_Uniforms.empty());
+  const unsigned int hash = HashName(name);
+  const unsigned int mask = (unsigned int)m_Uniforms.size() - 1;
+  unsigned int index = hash & mask;
+  while(m_Uniforms[index].location != -2)
+  {
+    UniformSlot& slot = m_Uniforms[index];
+    if(slot.hash == hash && slot.name == name)
+      return &slot;
+    index = (index + 1) & mask;
+  }
+
+  //not an active uniform (misspelled or optimised out). remember the miss
+  //so the warning is printed once and later lookups stay in the table
+  std::cout << "Warning: uniform " << name << " doesn't exist in " << m_FilePath << std::endl;
+  return InsertUniform(name, hash, -1);
+}
+
+bool Shader::UpdateCache(UniformSlot* slot, const void* value, unsigned int size)
+{
+  if(slot->location == -1)
+    return false;
+  if(size > sizeof(slot->value))
+    return true; //too big to cache, always upload
+  if(slot->size == size && memcmp(slot->value, value, size) == 0)
+    return false;
+  memcpy(slot->value, value, size);
+  slot->size = size;
+  return true;
+}
+
+int Shader::GetUniformLocation(const char* name)
+{
+  if(!IsReady())
+    return -1;
+  return FindUniform(name)->location;
+}
+
+void Shader::SetUniform1i(const char* name, int value)
+{
+  if(!IsReady())
+    return;
+  UniformSlot* slot = FindUniform(name);
+  if(UpdateCache(slot, &value, sizeof(value)))
+  {
+    GLCALL(glUniform1i(slot->location, value));
+  }
+}
+
+void Shader::SetUniform1iv(const char* name, int count, const int* values)
+{
+  if(!IsReady())
+    return;
+  UniformSlot* slot = FindUniform(name);
+  if(UpdateCache(slot, values, count * sizeof(int)))
+  {
+    GLCALL(glUniform1iv(slot->location, count, values));
+  }
+}
+
+void Shader::SetUniform1f(const char* name, float value)
+{
+  if(!IsReady())
+    return;
+  UniformSlot* slot = FindUniform(name);
+  if(UpdateCache(slot, &value, sizeof(value)))
+  {
+    GLCALL(glUniform1f(slot->location, value));
+  }
+}
+
+void Shader::SetUniform4f(const char* name, float v0, float v1, float v2, float v3)
+{
+  if(!IsReady())
+    return;
+  UniformSlot* slot = FindUniform(name);
+  const float value[4] = { v0, v1, v2, v3 };
+  if(UpdateCache(slot, value, sizeof(value)))
+  {
+    GLCALL(glUniform4f(slot->location, v0, v1, v2, v3));
+  }
+}
+
+void Shader::SetUniformMat4f(const char* name, const float* matrix)
+{
+  if(!IsReady())
+    return;
+  UniformSlot* slot = FindUniform(name);
+  if(UpdateCache(slot, matrix, 16 * sizeof(float)))
+  {
+    GLCALL(glUniformMatrix4fv(slot->location, 1, GL_FALSE, matrix));
+  }
+}
+
+void Shader::SetUniformBlockBinding(const char* name, unsigned int binding)
+{
+  bool found = false;
+  for(unsigned int i = 0; i < m_BlockBindings.size() && !found; i++)
+  {
+    if(m_BlockBindings[i].first == name)
+    {
+      m_BlockBindings[i].second = binding;
+      found = true;
+    }
+  }
+  if(!found)
+    m_BlockBindings.push_back(std::make_pair(std::string(name), binding));
+  if(IsReady())
+    ApplyBlockBindings();
+}
+
+void Shader::ApplyBlockBindings()
+{
+  for(unsigned int i = 0; i < m_BlockBindings.size(); i++)
+  {
+    //block binding is program state, unlike uniforms it needs no glUseProgram
+    GLCALL(unsigned int index = glGetUniformBlockIndex(m_RendererId, m_BlockBindings[i].first.c_str()));
+    if(index == GL_INVALID_INDEX)
+    {
+      std::cout << "Warning: uniform block " << m_BlockBindings[i].first << " doesn't exist in " << m_FilePath << std::endl;
+      continue;
+    }
+    GLCALL(glUniformBlockBinding(m_RendererId, index, m_BlockBindings[i].second));
+  }
+}
+
+void Shader::Bind() const
+{
+  if(IsReady())
+  {
+    GLCALL(glUseProgram(m_RendererId));
+  }
+  else
+  {
+    GLCALL(glUseProgram(s_Fallback && s_Fallback->IsReady() ? s_Fallback->m_RendererId : 0));
+  }
+}
+
+void Shader::Unbind() const
+{
+  GLCALL(glUseProgram(0));
+}
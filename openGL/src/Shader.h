@@ -0,0 +1,116 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "ShaderSource.h"
+#include "ShaderReflection.h"
+
+class ProgramBinaryCache;
+
+class Shader
+{
+private:
+  //one slot of the open-addressing uniform table. the last uploaded value is
+  //kept so that setting the same value again never reaches the driver.
+  struct UniformSlot
+  {
+    std::string name;
+    unsigned int hash;
+    int location;
+    unsigned int size; //bytes of value in use, 0 = nothing uploaded yet
+    unsigned char value[64];
+  };
+
+  enum class Status
+  {
+    COMPILING,
+    READY,
+    FAILED
+  };
+
+  static ProgramBinaryCache* s_BinaryCache;
+  static const Shader* s_Fallback;
+
+  std::string m_FilePath;
+  unsigned int m_RendererId;
+  Status m_Status;
+  //shader objects and cache key of a program that is still compiling
+  unsigned int m_PendingShaders[(int)ShaderStage::COUNT];
+  unsigned long long m_CacheKey;
+  std::vector<UniformSlot> m_Uniforms;
+  unsigned int m_UniformCount;
+  //inputs, uniforms and blocks of the linked program
+  ShaderReflection m_Reflection;
+  //every file the source was read from, the shader file first
+  std::vector<std::string> m_Dependencies;
+  //uniform block bindings, applied again whenever the program changes
+  std::vector<std::pair<std::string, unsigned int>> m_BlockBindings;
+  //program being rebuilt by Reload(), swapped in once it links
+  std::unique_ptr<Shader> m_Replacement;
+
+  void Init(const ShaderProgramSource& source, bool async);
+  unsigned int CompileShader(unsigned int type, const std::vector<std::string_view>& source);
+  //submits compile and link without waiting on the driver
+  void CreateShader(const ShaderProgramSource& source);
+  //reads back the results once the driver is done
+  void FinishShader();
+
+  void ApplyBlockBindings();
+  void BuildUniformTable();
+  UniformSlot* InsertUniform(const char* name, unsigned int hash, int location);
+  UniformSlot* FindUniform(const char* name);
+  //true if the value differs from the cached one (and caches it)
+  bool UpdateCache(UniformSlot* slot, const void* value, unsigned int size);
+
+public:
+  //linked programs are looked up in / written to this cache, nullptr disables it
+  static void SetBinaryCache(ProgramBinaryCache* cache) {s_BinaryCache = cache;}
+
+  //bound instead of every shader that is not ready yet (or failed to build)
+  static void SetFallback(const Shader* fallback) {s_Fallback = fallback;}
+
+  //async shaders return right after submitting the work to the driver,
+  //Poll() them (or hand them to a ShaderCompiler) until they are ready
+  Shader(const std::string& filepath, bool async = false);
+  //builds from an already parsed source, filepath is only used for messages
+  Shader(const std::string& filepath, const ShaderProgramSource& source, bool async = false);
+  ~Shader();
+
+  Shader(const Shader&) = delete;
+  Shader& operator=(const Shader&) = delete;
+
+  //starts building a new program from source while the current one stays in use.
+  //PollReload() swaps it in once it links; a failed build keeps the old program
+  void Reload(const ShaderProgramSource& source);
+  //returns true when no reload is in flight anymore, and whether the last one was applied
+  bool PollReload(bool* applied = nullptr);
+
+  //non-blocking while GL_KHR_parallel_shader_compile is available, returns true when done
+  bool Poll();
+  inline bool IsReady () const {return m_Status == Status::READY;}
+  inline bool IsFailed () const {return m_Status == Status::FAILED;}
+
+  void Bind() const;
+  void Unbind() const;
+
+  //the setters upload to the currently bound program, so Bind() first.
+  //they are ignored until the shader is ready
+  void SetUniform1i(const char* name, int value);
+  void SetUniform1iv(const char* name, int count, const int* values);
+  void SetUniform1f(const char* name, float value);
+  void SetUniform4f(const char* name, float v0, float v1, float v2, float v3);
+  void SetUniformMat4f(const char* name, const float* matrix);
+
+  //connects a uniform block to a binding point of UniformBuffer::BindRange.
+  //can be called before the shader is ready and survives reloads
+  void SetUniformBlockBinding(const char* name, unsigned int binding);
+
+  int GetUniformLocation(const char* name);
+  inline unsigned int GetRendererId () const {return m_RendererId;}
+  inline const std::string& GetFilePath () const {return m_FilePath;}
+  inline const std::vector<std::string>& GetDependencies () const {return m_Dependencies;}
+  //empty until the shader is ready
+  inline const ShaderReflection& GetReflection () const {return m_Reflection;}
+};
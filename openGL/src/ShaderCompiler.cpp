@@ -0,0 +1,35 @@
+#include "ShaderCompiler.h"
+#include "Renderer.h"
+
+ShaderCompiler::ShaderCompiler()
+{
+  if(GLEW_KHR_parallel_shader_compile)
+  {
+    //0xFFFFFFFF = implementation-defined maximum
+    GLCALL(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+  }
+}
+
+void ShaderCompiler::Submit(Shader& shader)
+{
+  m_Pending.push_back(&shader);
+}
+
+unsigned int ShaderCompiler::Poll()
+{
+  //without the extension every finalise blocks on the driver, so spread them one per frame
+  const bool parallel = GLEW_KHR_parallel_shader_compile != 0;
+  unsigned int kept = 0;
+  bool finished = false;
+  for(unsigned int i = 0; i < m_Pending.size(); i++)
+  {
+    if((parallel || !finished) && m_Pending[i]->Poll())
+    {
+      finished = true;
+      continue;
+    }
+    m_Pending[kept++] = m_Pending[i];
+  }
+  m_Pending.resize(kept);
+  return kept;
+}
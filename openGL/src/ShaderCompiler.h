@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include "Shader.h"
+
+//tracks async shaders and finalises them across frames, so a large shader
+//set loads in the background while the app keeps drawing with the fallback
+class ShaderCompiler
+{
+private:
+  std::vector<Shader*> m_Pending;
+
+public:
+  //lets the driver use as many compiler threads as it wants (GL_KHR_parallel_shader_compile)
+  ShaderCompiler();
+
+  //shader must be created with async = true and outlive the compiler or its completion
+  void Submit(Shader& shader);
+
+  //call once per frame, returns how many shaders are still compiling
+  unsigned int Poll();
+
+  inline bool IsIdle () const {return m_Pending.empty();}
+};
@@ -0,0 +1,98 @@
+#include "ShaderPermutations.h"
+#include <algorithm>
+#include "Renderer.h"
+
+ShaderPermutations::ShaderPermutations(const std::string& filepath, const ShaderProgramSource& source,
+  const std::vector<std::string>& features)
+  : m_FilePath(filepath), m_Features(features)
+{
+  ASSERT(features.size() <= 32);
+  for(unsigned int s = 0; s < (unsigned int)ShaderStage::COUNT; s++)
+  {
+    const std::vector<std::string_view>& slices = source.Stages[s];
+    for(unsigned int i = 0; i < slices.size(); i++)
+      m_Stages[s].append(slices[i].data(), slices[i].size());
+  }
+}
+
+unsigned int ShaderPermutations::GetFeatureBit(const std::string& feature) const
+{
+  for(unsigned int i = 0; i < m_Features.size(); i++)
+  {
+    if(m_Features[i] == feature)
+      return 1u << i;
+  }
+  return 0;
+}
+
+//splits the slice holding the #version line after that line and puts defines in between.
+//#version has to come first in a stage, so without one the defines go in front.
+static std::vector<std::string_view> InjectDefines(const std::vector<std::string_view>& stage,
+  std::string_view defines)
+{
+  std::vector<std::string_view> result;
+  result.reserve(stage.size() + 2);
+  bool injected = false;
+  for(unsigned int i = 0; i < stage.size(); i++)
+  {
+    std::string_view slice = stage[i];
+    size_t version = injected ? std::string_view::npos : slice.find("#version");
+    if(version == std::string_view::npos)
+    {
+      result.push_back(slice);
+      continue;
+    }
+
+    size_t end = slice.find('\n', version);
+    end = end == std::string_view::npos ? slice.size() : end + 1;
+    result.push_back(slice.substr(0, end));
+    //a #version line without a newline at the end of its slice would run into the defines
+    if(slice[end - 1] != '\n')
+      result.push_back("\n");
+    result.push_back(defines);
+    if(end < slice.size())
+      result.push_back(slice.substr(end));
+    injected = true;
+  }
+
+  if(!injected)
+    result.insert(result.begin(), defines);
+  return result;
+}
+
+std::unique_ptr<Shader> ShaderPermutations::CreateVariant(unsigned int mask) const
+{
+  std::string defines;
+  for(unsigned int i = 0; i < m_Features.size(); i++)
+  {
+    if(mask & (1u << i))
+      defines += "#define " + m_Features[i] + "\n";
+  }
+
+  //the slices only have to live until the Shader constructor has called glShaderSource
+  ShaderProgramSource variant;
+  for(unsigned int s = 0; s < (unsigned int)ShaderStage::COUNT; s++)
+  {
+    if(!m_Stages[s].empty())
+      variant.Stages[s] = InjectDefines(std::vector<std::string_view>(1, m_Stages[s]), defines);
+  }
+  return std::unique_ptr<Shader>(new Shader(m_FilePath, variant));
+}
+
+Shader& ShaderPermutations::Get(unsigned int mask)
+{
+  //bits above the feature count would only create duplicate variants
+  ASSERT(m_Features.size() == 32 || (mask >> m_Features.size()) == 0);
+
+  std::vector<std::pair<unsigned int, std::unique_ptr<Shader>>>::iterator it =
+    std::lower_bound(m_Variants.begin(), m_Variants.end(), mask,
+      [](const std::pair<unsigned int, std::unique_ptr<Shader>>& variant, unsigned int key)
+      {
+        return variant.first < key;
+      });
+  if(it != m_Variants.end() && it->first == mask)
+    return *it->second;
+
+  it = m_Variants.insert(it, std::make_pair(mask, CreateVariant(mask)));
+  return *it->second;
+}
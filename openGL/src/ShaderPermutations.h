@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Shader.h"
+#include "ShaderSource.h"
+
+//variants of one shader selected by a feature bitmask. bit i of the mask adds
+//"#define <features[i]>" right after the #version line of every stage.
+//a variant is compiled the first time it is asked for, never upfront.
+//the stage text is copied when constructed, the mapped files are not kept open.
+class ShaderPermutations
+{
+private:
+  std::string m_FilePath;
+  //owned copies, so shader files can be edited (or truncated) while variants are still
+  //compiled from them later, and Windows editors aren't blocked by an open mapping
+  std::string m_Stages[(int)ShaderStage::COUNT];
+  std::vector<std::string> m_Features;
+  //flat map sorted by mask
+  std::vector<std::pair<unsigned int, std::unique_ptr<Shader>>> m_Variants;
+
+  std::unique_ptr<Shader> CreateVariant(unsigned int mask) const;
+
+public:
+  //source as returned by ParseShader(filepath), at most 32 features
+  ShaderPermutations(const std::string& filepath, const ShaderProgramSource& source,
+    const std::vector<std::string>& features);
+
+  //bit of a feature name, 0 if there is no such feature
+  unsigned int GetFeatureBit(const std::string& feature) const;
+
+  //compiles and links the variant on first use
+  Shader& Get(unsigned int mask);
+
+  inline unsigned int GetVariantCount () const {return (unsigned int)m_Variants.size();}
+};
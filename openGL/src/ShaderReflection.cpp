@@ -0,0 +1,184 @@
+#include "ShaderReflection.h"
+#include <cstring>
+#include <iostream>
+#include "Renderer.h"
+#include "UniformBufferLayout.h"
+
+//arrays are reported as "name[0]", only that suffix goes. brackets inside the
+//name belong to arrays of structs ("u_Lights[0].color") and have to stay
+static std::string StripArray(const char* name)
+{
+  const size_t length = strlen(name);
+  if(length > 3 && strcmp(name + length - 3, "[0]") == 0)
+    return std::string(name, length - 3);
+  return std::string(name);
+}
+
+ShaderReflection ShaderReflection::Reflect(unsigned int program)
+{
+  ShaderReflection reflection;
+  int count = 0, maxLength = 0;
+
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count));
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength));
+  std::vector<char> name(maxLength + 1);
+  for(int i = 0; i < count; i++)
+  {
+    Attribute attribute;
+    int length = 0;
+    GLCALL(glGetActiveAttrib(program, i, (int)name.size(), &length, &attribute.size, &attribute.type, name.data()));
+    attribute.name = StripArray(name.data());
+    GLCALL(attribute.location = glGetAttribLocation(program, name.data()));
+    //built-ins like gl_VertexID are active but have no location
+    if(attribute.location != -1)
+      reflection.Attributes.push_back(attribute);
+  }
+
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count));
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+  name.assign(maxLength + 1, '\0');
+  for(int i = 0; i < count; i++)
+  {
+    Uniform uniform;
+    int length = 0;
+    const unsigned int index = i;
+    GLCALL(glGetActiveUniform(program, index, (int)name.size(), &length, &uniform.size, &uniform.type, name.data()));
+    GLCALL(glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.blockIndex));
+    GLCALL(glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &uniform.offset));
+    uniform.name = StripArray(name.data());
+    uniform.location = -1;
+    if(uniform.blockIndex == -1)
+    {
+      GLCALL(uniform.location = glGetUniformLocation(program, uniform.name.c_str()));
+    }
+    reflection.Uniforms.push_back(uniform);
+  }
+
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+  GLCALL(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength));
+  name.assign(maxLength + 1, '\0');
+  for(int i = 0; i < count; i++)
+  {
+    Block block;
+    int length = 0, size = 0;
+    GLCALL(glGetActiveUniformBlockName(program, i, (int)name.size(), &length, name.data()));
+    GLCALL(glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size));
+    block.name = name.data();
+    block.index = i;
+    block.size = size;
+    reflection.Blocks.push_back(block);
+  }
+  return reflection;
+}
+
+const ShaderReflection::Attribute* ShaderReflection::FindAttribute(const char* name) const
+{
+  for(unsigned int i = 0; i < Attributes.size(); i++)
+  {
+    if(Attributes[i].name == name)
+      return &Attributes[i];
+  }
+  return nullptr;
+}
+
+const ShaderReflection::Uniform* ShaderReflection::FindUniform(const char* name) const
+{
+  for(unsigned int i = 0; i < Uniforms.size(); i++)
+  {
+    if(Uniforms[i].name == name)
+      return &Uniforms[i];
+  }
+  return nullptr;
+}
+
+const ShaderReflection::Block* ShaderReflection::FindBlock(const char* name) const
+{
+  for(unsigned int i = 0; i < Blocks.size(); i++)
+  {
+    if(Blocks[i].name == name)
+      return &Blocks[i];
+  }
+  return nullptr;
+}
+
+bool ShaderReflection::ValidateBlock(const char* name, const UniformBlockLayout& layout) const
+{
+  const Block* block = FindBlock(name);
+  if(!block)
+    return true; //not used by this program, nothing to get wrong
+
+  bool valid = true;
+  if(block->size != layout.GetSize())
+  {
+    std::cout << "Uniform block " << name << " is " << block->size << " bytes, the layout has "
+      << layout.GetSize() << std::endl;
+    valid = false;
+  }
+
+  for(unsigned int i = 0; i < Uniforms.size(); i++)
+  {
+    const Uniform& uniform = Uniforms[i];
+    if(uniform.blockIndex != (int)block->index)
+      continue;
+    //members of a named block instance come as "Instance.member"
+    std::string member = uniform.name;
+    size_t dot = member.find('.');
+    if(dot != std::string::npos && member.compare(0, dot, block->name) == 0)
+      member = member.substr(dot + 1);
+    //struct members are checked through the struct's own layout
+    if(member.find_first_of(".[") != std::string::npos)
+      continue;
+
+    int element = layout.Find(member);
+    if(element == -1)
+    {
+      std::cout << "Uniform block " << name << " member " << member << " is missing in the layout" << std::endl;
+      valid = false;
+    }
+    else if(layout.GetOffset(element) != (unsigned int)uniform.offset)
+    {
+      std::cout << "Uniform block " << name << " member " << member << " is at " << uniform.offset
+        << ", the layout puts it at " << layout.GetOffset(element) << std::endl;
+      valid = false;
+    }
+  }
+  return valid;
+}
+
+unsigned int ShaderReflection::GetComponentCount(unsigned int type)
+{
+  switch(type)
+  {
+    case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: return 1;
+    case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: return 2;
+    case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: return 3;
+    case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: return 4;
+    //per column
+    case GL_FLOAT_MAT2: return 2;
+    case GL_FLOAT_MAT3: return 3;
+    case GL_FLOAT_MAT4: return 4;
+  }
+  return 0;
+}
+
+unsigned int ShaderReflection::GetLocationCount(unsigned int type)
+{
+  switch(type)
+  {
+    case GL_FLOAT_MAT2: return 2;
+    case GL_FLOAT_MAT3: return 3;
+    case GL_FLOAT_MAT4: return 4;
+  }
+  return 1;
+}
+
+bool ShaderReflection::IsIntegerType(unsigned int type)
+{
+  switch(type)
+  {
+    case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+    case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+      return true;
+  }
+  return false;
+}
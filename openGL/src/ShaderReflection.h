@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class UniformBlockLayout;
+
+//what a linked program actually uses, queried once after linking.
+//anything the compiler optimised away is not listed.
+struct ShaderReflection
+{
+  struct Attribute
+  {
+    std::string name;
+    unsigned int type; //e.g. GL_FLOAT_VEC3
+    int size; //array length
+    int location;
+  };
+
+  struct Uniform
+  {
+    std::string name; //arrays without the "[0]"
+    unsigned int type;
+    int size;
+    int location; //-1 for members of a block
+    int blockIndex; //-1 for default block uniforms
+    int offset; //byte offset inside the block
+  };
+
+  struct Block
+  {
+    std::string name;
+    unsigned int index;
+    unsigned int size; //GL_UNIFORM_BLOCK_DATA_SIZE
+  };
+
+  std::vector<Attribute> Attributes;
+  std::vector<Uniform> Uniforms;
+  std::vector<Block> Blocks;
+
+  //program has to be linked successfully
+  static ShaderReflection Reflect(unsigned int program);
+
+  //nullptr if the program has no active input / uniform / block of that name
+  const Attribute* FindAttribute(const char* name) const;
+  const Uniform* FindUniform(const char* name) const;
+  const Block* FindBlock(const char* name) const;
+
+  //true if every member of the block the program uses sits at the offset the layout
+  //computed and the block is as large; mismatches are printed
+  bool ValidateBlock(const char* name, const UniformBlockLayout& layout) const;
+
+  //components per location of an attribute type, 0 for unsupported types
+  static unsigned int GetComponentCount(unsigned int type);
+  //square matrices take one location per column
+  static unsigned int GetLocationCount(unsigned int type);
+  //int/uint inputs have to be fed with glVertexAttribIPointer
+  static bool IsIntegerType(unsigned int type);
+};
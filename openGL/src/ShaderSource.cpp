@@ -0,0 +1,206 @@
+#include "ShaderSource.h"
+#include "Renderer.h"
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+//a file that fails to end in a newline would run into the line after its #include
+static const std::string_view NEWLINE("\n", 1);
+static const unsigned int MAX_INCLUDE_DEPTH = 32;
+
+unsigned int GetShaderStageType(ShaderStage stage)
+{
+  switch(stage)
+  {
+    case ShaderStage::VERTEX: return GL_VERTEX_SHADER;
+    case ShaderStage::FRAGMENT: return GL_FRAGMENT_SHADER;
+    case ShaderStage::GEOMETRY: return GL_GEOMETRY_SHADER;
+    case ShaderStage::TESS_CONTROL: return GL_TESS_CONTROL_SHADER;
+    case ShaderStage::TESS_EVALUATION: return GL_TESS_EVALUATION_SHADER;
+    case ShaderStage::COMPUTE: return GL_COMPUTE_SHADER;
+    default: break;
+  }
+  ASSERT(false);
+  return 0;
+}
+
+const char* GetShaderStageName(ShaderStage stage)
+{
+  static const char* names[] = { "vertex", "fragment", "geometry", "tess_control", "tess_evaluation", "compute" };
+  return names[(int)stage];
+}
+
+//include cache: a file used by several shaders (or stages) is mapped once while any
+//parsed source still uses it. the write time is checked so edited files are remapped.
+struct CachedFile
+{
+  std::weak_ptr<MappedFile> file;
+  std::filesystem::file_time_type writeTime;
+};
+
+static std::shared_ptr<MappedFile> OpenCached(const std::string& path)
+{
+  static std::mutex s_Mutex;
+  static std::unordered_map<std::string, CachedFile> s_Files;
+
+  std::error_code error;
+  std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+  if(error)
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(s_Mutex);
+  CachedFile& entry = s_Files[path];
+  std::shared_ptr<MappedFile> file = entry.file.lock();
+  if(file && entry.writeTime == writeTime)
+    return file;
+
+  file = std::make_shared<MappedFile>(path);
+  if(!file->IsValid())
+  {
+    s_Files.erase(path);
+    return nullptr;
+  }
+  entry.file = file;
+  entry.writeTime = writeTime;
+  return file;
+}
+
+static bool StartsWith(std::string_view text, std::string_view prefix)
+{
+  return text.substr(0, prefix.size()) == prefix;
+}
+
+static std::string_view TrimLeft(std::string_view text)
+{
+  size_t first = text.find_first_not_of(" \t");
+  return first == std::string_view::npos ? std::string_view() : text.substr(first);
+}
+
+struct ParseContext
+{
+  ShaderProgramSource* source;
+  int stage; //-1 until the first #shader tag
+  std::vector<std::string> included; //files already pulled into the current stage
+};
+
+static bool ParseFile(ParseContext& ctx, const std::string& path, bool topLevel, unsigned int depth);
+
+static void AddSlice(ParseContext& ctx, std::string_view slice, bool topLevel)
+{
+  if(slice.empty())
+    return;
+  if(ctx.stage < 0)
+  {
+    if(topLevel && slice.find_first_not_of(" \t\r\n") != std::string_view::npos)
+      std::cout << "Warning: text before the first #shader tag is ignored" << std::endl;
+    return;
+  }
+  ctx.source->Stages[ctx.stage].push_back(slice);
+}
+
+static int ParseStage(std::string_view name)
+{
+  for(int i = 0; i < (int)ShaderStage::COUNT; i++)
+  {
+    if(StartsWith(name, GetShaderStageName((ShaderStage)i)))
+      return i;
+  }
+  return -1;
+}
+
+static void ParseInclude(ParseContext& ctx, const std::string& path, std::string_view directive,
+  unsigned int depth)
+{
+  //accepts "file" and <file>
+  size_t open = directive.find_first_of("\"<");
+  size_t close = open == std::string_view::npos ? open : directive.find_first_of("\">", open + 1);
+  if(close == std::string_view::npos)
+  {
+    std::cout << "Malformed #include in " << path << std::endl;
+    return;
+  }
+
+  std::filesystem::path target = std::filesystem::path(path).parent_path() /
+    std::string(directive.substr(open + 1, close - open - 1));
+  std::string resolved = target.lexically_normal().string();
+
+  for(unsigned int i = 0; i < ctx.included.size(); i++)
+  {
+    if(ctx.included[i] == resolved)
+      return;
+  }
+  ctx.included.push_back(resolved);
+
+  if(depth >= MAX_INCLUDE_DEPTH)
+  {
+    std::cout << "#include nested too deep in " << path << std::endl;
+    return;
+  }
+  if(!ParseFile(ctx, resolved, false, depth + 1))
+    std::cout << "Cannot open " << resolved << " included from " << path << std::endl;
+}
+
+static bool ParseFile(ParseContext& ctx, const std::string& path, bool topLevel, unsigned int depth)
+{
+  std::shared_ptr<MappedFile> file = OpenCached(path);
+  if(!file)
+    return false;
+
+  bool known = false;
+  for(unsigned int i = 0; i < ctx.source->Files.size() && !known; i++)
+    known = ctx.source->Files[i] == file;
+  if(!known)
+    ctx.source->Files.push_back(file);
+
+  const std::string_view text = file->GetView();
+  size_t sliceStart = 0;
+  size_t pos = 0;
+  while(pos < text.size())
+  {
+    size_t lineEnd = text.find('\n', pos);
+    size_t next = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+    std::string_view line = TrimLeft(text.substr(pos, next - pos));
+
+    if(!line.empty() && line[0] == '#')
+    {
+      std::string_view directive = TrimLeft(line.substr(1));
+      if(StartsWith(directive, "shader"))
+      {
+        AddSlice(ctx, text.substr(sliceStart, pos - sliceStart), topLevel);
+        sliceStart = next;
+        if(!topLevel)
+          std::cout << "Warning: #shader tag in included file " << path << " is ignored" << std::endl;
+        else
+        {
+          ctx.stage = ParseStage(TrimLeft(directive.substr(6)));
+          ctx.included.clear();
+          if(ctx.stage < 0)
+            std::cout << "Unknown #shader stage in " << path << std::endl;
+        }
+      }
+      else if(StartsWith(directive, "include"))
+      {
+        AddSlice(ctx, text.substr(sliceStart, pos - sliceStart), topLevel);
+        sliceStart = next;
+        if(ctx.stage >= 0)
+          ParseInclude(ctx, path, directive.substr(7), depth);
+      }
+    }
+    pos = next;
+  }
+  AddSlice(ctx, text.substr(sliceStart), topLevel);
+
+  if(!topLevel && !text.empty() && text.back() != '\n')
+    AddSlice(ctx, NEWLINE, false);
+  return true;
+}
+
+ShaderProgramSource ParseShader(const std::string& filepath)
+{
+  ShaderProgramSource source;
+  ParseContext ctx = { &source, -1, std::vector<std::string>() };
+  if(!ParseFile(ctx, filepath, true, 0))
+    std::cout << "Cannot open shader " << filepath << std::endl;
+  return source;
+}
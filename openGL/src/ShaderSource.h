@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+
+enum class ShaderStage
+{
+  VERTEX = 0,
+  FRAGMENT,
+  GEOMETRY,
+  TESS_CONTROL,
+  TESS_EVALUATION,
+  COMPUTE,
+  COUNT
+};
+
+unsigned int GetShaderStageType(ShaderStage stage);
+const char* GetShaderStageName(ShaderStage stage);
+
+//every stage is a list of slices into memory mapped files, including the
+//files pulled in through #include. the slices are handed to glShaderSource
+//as they are, so nothing is copied. Files keeps the mappings alive.
+struct ShaderProgramSource
+{
+  std::vector<std::string_view> Stages[(int)ShaderStage::COUNT];
+  std::vector<std::shared_ptr<MappedFile>> Files;
+
+  inline bool HasStage (ShaderStage stage) const {return !Stages[(int)stage].empty();}
+  inline const std::vector<std::string_view>& GetStage (ShaderStage stage) const {return Stages[(int)stage];}
+};
+
+//single pass over the file. "#shader vertex|fragment|geometry|tess_control|tess_evaluation|compute"
+//starts a stage, '#include "file"' is resolved relative to the including file and is
+//pulled into a stage only once. returns an empty source if the file can't be read.
+ShaderProgramSource ParseShader(const std::string& filepath);
@@ -0,0 +1,258 @@
+#include "ShaderWatcher.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+//how long the worker sleeps before checking the stop flag again
+static const int WAIT_TIMEOUT_MS = 100;
+//editors save in several steps, wait for the burst to end before reparsing
+static const int DEBOUNCE_MS = 50;
+
+static std::filesystem::file_time_type GetWriteTime(const std::string& path)
+{
+  std::error_code error;
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+  return error ? std::filesystem::file_time_type::min() : time;
+}
+
+ShaderWatcher::ShaderWatcher()
+  : m_DirectoriesChanged(false), m_Running(true)
+{
+  m_Thread = std::thread(&ShaderWatcher::Run, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+  m_Running = false;
+  m_Thread.join();
+}
+
+void ShaderWatcher::SetFiles(Entry& entry, const std::vector<std::string>& paths)
+{
+  std::vector<WatchedFile> files;
+  for(unsigned int i = 0; i < paths.size(); i++)
+  {
+    WatchedFile file = { std::filesystem::path(paths[i]).lexically_normal().string(), {} };
+    //files seen before keep the time the worker last checked,
+    //so an edit made while the rebuild ran is still picked up
+    bool known = false;
+    for(unsigned int j = 0; j < entry.Files.size() && !known; j++)
+    {
+      if(entry.Files[j].Path == file.Path)
+      {
+        file.WriteTime = entry.Files[j].WriteTime;
+        known = true;
+      }
+    }
+    if(!known)
+      file.WriteTime = GetWriteTime(file.Path);
+    files.push_back(file);
+
+    std::string directory = std::filesystem::path(file.Path).parent_path().string();
+    if(directory.empty())
+      directory = ".";
+    bool watched = false;
+    for(unsigned int j = 0; j < m_Directories.size() && !watched; j++)
+      watched = m_Directories[j] == directory;
+    if(!watched)
+    {
+      m_Directories.push_back(directory);
+      m_DirectoriesChanged = true;
+    }
+  }
+  entry.Files.swap(files);
+}
+
+void ShaderWatcher::Watch(Shader& shader)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Entry entry = { &shader, shader.GetFilePath(), {}, false };
+  SetFiles(entry, shader.GetDependencies());
+  m_Entries.push_back(entry);
+}
+
+void ShaderWatcher::ScanForChanges()
+{
+  std::vector<std::pair<Shader*, std::string>> changed;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for(unsigned int i = 0; i < m_Entries.size(); i++)
+    {
+      bool dirty = false;
+      std::vector<WatchedFile>& files = m_Entries[i].Files;
+      for(unsigned int j = 0; j < files.size(); j++)
+      {
+        std::filesystem::file_time_type time = GetWriteTime(files[j].Path);
+        if(time != files[j].WriteTime)
+        {
+          files[j].WriteTime = time;
+          dirty = true;
+        }
+      }
+      if(dirty)
+        changed.push_back(std::make_pair(m_Entries[i].Target, m_Entries[i].Path));
+    }
+  }
+
+  //parsing touches only the file system, so it stays on this thread
+  for(unsigned int i = 0; i < changed.size(); i++)
+  {
+    Parsed parsed = { changed[i].first, ParseShader(changed[i].second) };
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Parsed.push_back(std::move(parsed));
+  }
+}
+
+#ifdef _WIN32
+void ShaderWatcher::Run()
+{
+  std::vector<HANDLE> handles;
+  while(m_Running)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if(m_DirectoriesChanged)
+      {
+        //WaitForMultipleObjects takes at most MAXIMUM_WAIT_OBJECTS handles
+        for(unsigned int i = (unsigned int)handles.size(); i < m_Directories.size() && i < MAXIMUM_WAIT_OBJECTS; i++)
+        {
+          HANDLE handle = FindFirstChangeNotificationA(m_Directories[i].c_str(), FALSE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+          if(handle == INVALID_HANDLE_VALUE)
+            std::cout << "Failed to watch " << m_Directories[i] << std::endl;
+          handles.push_back(handle);
+        }
+        m_DirectoriesChanged = false;
+      }
+    }
+
+    std::vector<HANDLE> valid;
+    for(unsigned int i = 0; i < handles.size(); i++)
+    {
+      if(handles[i] != INVALID_HANDLE_VALUE)
+        valid.push_back(handles[i]);
+    }
+    if(valid.empty())
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MS));
+      continue;
+    }
+
+    DWORD result = WaitForMultipleObjects((DWORD)valid.size(), valid.data(), FALSE, WAIT_TIMEOUT_MS);
+    if(result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + valid.size())
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(DEBOUNCE_MS));
+      for(unsigned int i = 0; i < valid.size(); i++)
+        FindNextChangeNotification(valid[i]);
+      ScanForChanges();
+    }
+  }
+
+  for(unsigned int i = 0; i < handles.size(); i++)
+  {
+    if(handles[i] != INVALID_HANDLE_VALUE)
+      FindCloseChangeNotification(handles[i]);
+  }
+}
+#elif defined(__linux__)
+void ShaderWatcher::Run()
+{
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(fd < 0)
+    std::cout << "inotify unavailable, shader hot reload disabled" << std::endl;
+  unsigned int watched = 0;
+  char events[4096];
+
+  while(m_Running && fd >= 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if(m_DirectoriesChanged)
+      {
+        //editors either rewrite the file in place or rename a temp file over it
+        for(; watched < m_Directories.size(); watched++)
+        {
+          if(inotify_add_watch(fd, m_Directories[watched].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+            std::cout << "Failed to watch " << m_Directories[watched] << std::endl;
+        }
+        m_DirectoriesChanged = false;
+      }
+    }
+
+    pollfd request = { fd, POLLIN, 0 };
+    if(poll(&request, 1, WAIT_TIMEOUT_MS) <= 0)
+      continue;
+
+    //the events only tell us to look, the write times decide what changed
+    std::this_thread::sleep_for(std::chrono::milliseconds(DEBOUNCE_MS));
+    while(read(fd, events, sizeof(events)) > 0);
+    ScanForChanges();
+  }
+
+  if(fd >= 0)
+    close(fd);
+}
+#else
+void ShaderWatcher::Run()
+{
+  //no change notifications on this platform, compare the write times periodically
+  while(m_Running)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MS * 5));
+    ScanForChanges();
+  }
+}
+#endif
+
+void ShaderWatcher::Update()
+{
+  std::vector<Parsed> parsed;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    parsed.swap(m_Parsed);
+  }
+
+  //m_Entries only grows from Watch(), which runs on this thread too
+  for(unsigned int i = 0; i < parsed.size(); i++)
+  {
+    bool empty = true;
+    for(unsigned int s = 0; s < (unsigned int)ShaderStage::COUNT && empty; s++)
+      empty = !parsed[i].Source.HasStage((ShaderStage)s);
+    if(empty)
+      continue; //half-written or unreadable file, wait for the next save
+
+    for(unsigned int j = 0; j < m_Entries.size(); j++)
+    {
+      if(m_Entries[j].Target == parsed[i].Target)
+      {
+        std::cout << "Reloading " << m_Entries[j].Path << std::endl;
+        parsed[i].Target->Reload(parsed[i].Source);
+        m_Entries[j].Reloading = true;
+      }
+    }
+  }
+
+  for(unsigned int i = 0; i < m_Entries.size(); i++)
+  {
+    Entry& entry = m_Entries[i];
+    bool applied = false;
+    if(!entry.Reloading || !entry.Target->PollReload(&applied))
+      continue;
+    entry.Reloading = false;
+    //includes may have been added or removed
+    if(applied)
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      SetFiles(entry, entry.Target->GetDependencies());
+    }
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Shader.h"
+#include "ShaderSource.h"
+
+//hot reload: a background thread waits for file change notifications
+//(inotify on linux, change handles on windows), reparses the touched shaders
+//and hands the sources to Update(), which rebuilds them without blocking the frame
+class ShaderWatcher
+{
+private:
+  struct WatchedFile
+  {
+    std::string Path;
+    std::filesystem::file_time_type WriteTime;
+  };
+  struct Entry
+  {
+    Shader* Target;
+    std::string Path;
+    //guarded by m_Mutex, the worker reads it and Update() refreshes it after a reload
+    std::vector<WatchedFile> Files;
+    bool Reloading;
+  };
+  struct Parsed
+  {
+    Shader* Target;
+    ShaderProgramSource Source;
+  };
+
+  std::mutex m_Mutex;
+  std::vector<Entry> m_Entries;
+  std::vector<Parsed> m_Parsed;
+  //directories the worker should watch, appended by Watch()
+  std::vector<std::string> m_Directories;
+  bool m_DirectoriesChanged;
+  std::atomic<bool> m_Running;
+  std::thread m_Thread;
+
+  void Run();
+  void ScanForChanges();
+  void SetFiles(Entry& entry, const std::vector<std::string>& paths);
+
+public:
+  ShaderWatcher();
+  ~ShaderWatcher();
+
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+  //the shader must outlive the watcher, every file it was parsed from is watched
+  void Watch(Shader& shader);
+
+  //call once per frame on the GL thread, starts and swaps in the rebuilt programs
+  void Update();
+};
@@ -0,0 +1,134 @@
+#include "TriangleStrip.h"
+#include "Renderer.h"
+#include <unordered_map>
+
+typedef std::unordered_multimap<unsigned long long, unsigned int> EdgeMap;
+
+static unsigned long long EdgeKey(unsigned int a, unsigned int b)
+{
+  return ((unsigned long long)a << 32) | b;
+}
+
+//finds an unused triangle walking the directed edge a->b, returns its third vertex
+static bool FindNeighbour(const EdgeMap& edges, const unsigned int* indices,
+  const std::vector<unsigned int>& used, unsigned int stamp,
+  unsigned int a, unsigned int b, unsigned int& triangle, unsigned int& third)
+{
+  auto range = edges.equal_range(EdgeKey(a, b));
+  for(auto it = range.first; it != range.second; ++it)
+  {
+    const unsigned int t = it->second;
+    if(used[t] == ~0u || used[t] == stamp)
+      continue;
+    const unsigned int* tri = indices + t * 3;
+    for(unsigned int k = 0; k < 3; k++)
+    {
+      if(tri[k] == a)
+      {
+        triangle = t;
+        third = tri[(k + 2) % 3];
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//grows a strip from the first triangle in the given rotation.
+//triangles taken by this attempt are tagged with stamp, committed ones with ~0u.
+static void GrowStrip(const EdgeMap& edges, const unsigned int* indices,
+  std::vector<unsigned int>& used, unsigned int stamp,
+  unsigned int start, unsigned int rotation,
+  std::vector<unsigned int>& strip, std::vector<unsigned int>& triangles)
+{
+  const unsigned int* tri = indices + start * 3;
+  strip.clear();
+  triangles.clear();
+  strip.push_back(tri[rotation]);
+  strip.push_back(tri[(rotation + 1) % 3]);
+  strip.push_back(tri[(rotation + 2) % 3]);
+  triangles.push_back(start);
+  used[start] = stamp;
+
+  for(;;)
+  {
+    const size_t n = strip.size();
+    //even triangles are (s[k], s[k+1], s[k+2]), odd ones flip the first two
+    const bool even = ((n - 2) % 2) == 0;
+    const unsigned int a = even ? strip[n - 2] : strip[n - 1];
+    const unsigned int b = even ? strip[n - 1] : strip[n - 2];
+
+    unsigned int next, third;
+    if(!FindNeighbour(edges, indices, used, stamp, a, b, next, third))
+      break;
+    used[next] = stamp;
+    strip.push_back(third);
+    triangles.push_back(next);
+  }
+}
+
+std::vector<unsigned int> GenerateTriangleStrips(const unsigned int* indices, unsigned int indexCount)
+{
+  ASSERT(indexCount % 3 == 0);
+  const unsigned int triangleCount = indexCount / 3;
+
+  EdgeMap edges;
+  edges.reserve(indexCount);
+  for(unsigned int t = 0; t < triangleCount; t++)
+  {
+    const unsigned int* tri = indices + t * 3;
+    for(unsigned int k = 0; k < 3; k++)
+      edges.insert(std::make_pair(EdgeKey(tri[k], tri[(k + 1) % 3]), t));
+  }
+
+  //0 = free, ~0u = emitted, anything else = taken by the current trial
+  std::vector<unsigned int> used(triangleCount, 0);
+  std::vector<unsigned int> result;
+  result.reserve(indexCount);
+  std::vector<unsigned int> strip, triangles, bestStrip, bestTriangles;
+  unsigned int stamp = 0;
+
+  for(unsigned int t = 0; t < triangleCount; t++)
+  {
+    if(used[t] == ~0u)
+      continue;
+
+    //the starting rotation decides the direction the strip walks in, keep the longest
+    bestStrip.clear();
+    for(unsigned int r = 0; r < 3; r++)
+    {
+      stamp++;
+      if(stamp == ~0u)
+        stamp = 1;
+      GrowStrip(edges, indices, used, stamp, t, r, strip, triangles);
+      for(unsigned int i = 0; i < triangles.size(); i++)
+        used[triangles[i]] = 0;
+      if(strip.size() > bestStrip.size())
+      {
+        bestStrip.swap(strip);
+        bestTriangles.swap(triangles);
+      }
+    }
+
+    for(unsigned int i = 0; i < bestTriangles.size(); i++)
+      used[bestTriangles[i]] = ~0u;
+    if(!result.empty())
+      result.push_back(PRIMITIVE_RESTART_INDEX);
+    result.insert(result.end(), bestStrip.begin(), bestStrip.end());
+  }
+  return result;
+}
+
+void EnablePrimitiveRestart()
+{
+  if(GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility)
+  {
+    GLCALL(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+  }
+  else
+  {
+    //GL 3.1 style restart with an explicit index
+    GLCALL(glEnable(GL_PRIMITIVE_RESTART));
+    GLCALL(glPrimitiveRestartIndex(PRIMITIVE_RESTART_INDEX));
+  }
+}
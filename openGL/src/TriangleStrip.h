@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+
+//separates strips when GL_PRIMITIVE_RESTART_FIXED_INDEX is enabled
+static const unsigned int PRIMITIVE_RESTART_INDEX = 0xFFFFFFFF;
+
+//converts a triangle list into triangle strips joined by PRIMITIVE_RESTART_INDEX.
+//winding is preserved, the result is meant to be drawn as GL_TRIANGLE_STRIP.
+std::vector<unsigned int> GenerateTriangleStrips(const unsigned int* indices, unsigned int indexCount);
+
+//must be called once after glewInit() before drawing strips with restart indices
+void EnablePrimitiveRestart();
@@ -0,0 +1,61 @@
+#include "UniformBuffer.h"
+#include <cstring>
+
+UniformBuffer::UniformBuffer(unsigned int capacity)
+  : m_Capacity(capacity), m_Used(0)
+{
+  int alignment = 0, maxBlockSize = 0;
+  GLCALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+  GLCALL(glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize));
+  //the spec caps the alignment at 256, anything unreasonable falls back to that
+  m_Alignment = alignment > 0 && (alignment & (alignment - 1)) == 0 ? alignment : 256;
+  m_MaxBlockSize = maxBlockSize > 0 ? maxBlockSize : 16384;
+  m_Data.reserve(capacity);
+
+  GLCALL(glGenBuffers(1, &m_RendererId));
+  GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, m_RendererId));
+  GLCALL(glBufferData(GL_UNIFORM_BUFFER, m_Capacity, nullptr, GL_DYNAMIC_DRAW));
+  GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+UniformBuffer::~UniformBuffer()
+{
+  GLCALL(glDeleteBuffers(1, &m_RendererId));
+}
+
+void UniformBuffer::Reset()
+{
+  m_Used = 0;
+  m_Data.clear();
+}
+
+UniformBlockRange UniformBuffer::Allocate(unsigned int size)
+{
+  ASSERT(size > 0 && size <= m_MaxBlockSize);
+  UniformBlockRange range;
+  range.offset = (m_Used + m_Alignment - 1) & ~(m_Alignment - 1);
+  range.size = size;
+  m_Used = range.offset + size;
+  //zeroed so padding and unset members never leak stale values into the shader
+  m_Data.resize(m_Used, 0);
+  return range;
+}
+
+void UniformBuffer::Upload()
+{
+  if(m_Used == 0)
+    return;
+
+  GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, m_RendererId));
+  while(m_Capacity < m_Used)
+    m_Capacity = m_Capacity ? m_Capacity * 2 : m_Used;
+  //orphaning gives us fresh storage, so the draws of the previous frame don't stall the upload
+  GLCALL(glBufferData(GL_UNIFORM_BUFFER, m_Capacity, nullptr, GL_DYNAMIC_DRAW));
+  GLCALL(glBufferSubData(GL_UNIFORM_BUFFER, 0, m_Used, m_Data.data()));
+  GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+void UniformBuffer::BindRange(unsigned int binding, const UniformBlockRange& range) const
+{
+  GLCALL(glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_RendererId, range.offset, range.size));
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "UniformBufferLayout.h"
+
+//one big uniform buffer that all per-frame, per-material and per-object blocks
+//are sub-allocated from. blocks are filled on the cpu, Upload() sends them with
+//a single call and BindRange() attaches a block to a binding point.
+//usage per frame: Reset, Allocate + fill, Upload, then BindRange before each draw.
+class UniformBuffer
+{
+private:
+  unsigned int m_RendererId;
+  unsigned int m_Capacity; //size of the gl buffer
+  unsigned int m_Alignment; //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  unsigned int m_MaxBlockSize; //GL_MAX_UNIFORM_BLOCK_SIZE
+  std::vector<unsigned char> m_Data;
+  unsigned int m_Used;
+
+public:
+  UniformBuffer(unsigned int capacity);
+  ~UniformBuffer(void);
+
+  UniformBuffer(const UniformBuffer&) = delete;
+  UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+  //forgets every block of the previous frame
+  void Reset();
+
+  //returns a zeroed block, ranges stay valid until the next Reset
+  UniformBlockRange Allocate(unsigned int size);
+  inline UniformBlockRange Allocate(const UniformBlockLayout& layout) {return Allocate(layout.GetSize());}
+  inline void* GetData(const UniformBlockRange& range) {return &m_Data[range.offset];}
+  inline const void* GetData(const UniformBlockRange& range) const {return &m_Data[range.offset];}
+
+  //orphans the buffer and uploads every block allocated since Reset, grows the buffer if needed
+  void Upload();
+
+  //glBindBufferRange on the binding point a block was assigned with Shader::SetUniformBlockBinding
+  void BindRange(unsigned int binding, const UniformBlockRange& range) const;
+
+  inline unsigned int GetRendererId () const {return m_RendererId;}
+  inline unsigned int GetUsed () const {return m_Used;}
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glew.h>
+#include "Renderer.h"
+
+//plain vector types matching the GLSL ones, e.g. Push<Vec4>("u_Color")
+struct Vec2 { float x, y; };
+struct Vec3 { float x, y, z; };
+struct Vec4 { float x, y, z, w; };
+//column-major, 16 floats as SetUniformMat4f takes them
+struct Mat4 { float m[16]; };
+
+//std140 base alignment and size of a C++ type, unsupported types fail to compile
+template<typename T>
+struct UniformType
+{
+  static_assert(sizeof(T) == 0, "unsupported uniform block type");
+};
+
+template<> struct UniformType<float>
+{
+  static constexpr unsigned int type = GL_FLOAT;
+  static constexpr unsigned int alignment = 4;
+};
+template<> struct UniformType<int>
+{
+  static constexpr unsigned int type = GL_INT;
+  static constexpr unsigned int alignment = 4;
+};
+template<> struct UniformType<unsigned int>
+{
+  static constexpr unsigned int type = GL_UNSIGNED_INT;
+  static constexpr unsigned int alignment = 4;
+};
+template<> struct UniformType<Vec2>
+{
+  static constexpr unsigned int type = GL_FLOAT_VEC2;
+  static constexpr unsigned int alignment = 8;
+};
+//vec3 is aligned like a vec4 but only takes 12 bytes, a float may follow it
+template<> struct UniformType<Vec3>
+{
+  static constexpr unsigned int type = GL_FLOAT_VEC3;
+  static constexpr unsigned int alignment = 16;
+};
+template<> struct UniformType<Vec4>
+{
+  static constexpr unsigned int type = GL_FLOAT_VEC4;
+  static constexpr unsigned int alignment = 16;
+};
+template<> struct UniformType<Mat4>
+{
+  static constexpr unsigned int type = GL_FLOAT_MAT4;
+  static constexpr unsigned int alignment = 16;
+};
+
+struct UniformBlockElement
+{
+  std::string name;
+  unsigned int type; //0 for a nested struct
+  unsigned int offset;
+  unsigned int size; //of one array element
+  unsigned int arrayCount; //0 = not an array
+  unsigned int arrayStride;
+};
+
+//builds the std140 layout of a uniform block member by member, in the order
+//they are declared in GLSL. Push returns the index used by Write/GetOffset.
+class UniformBlockLayout
+{
+private:
+  std::vector<UniformBlockElement> m_Elements;
+  unsigned int m_Size;
+
+  static unsigned int Align(unsigned int value, unsigned int alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  unsigned int Add(const std::string& name, unsigned int type, unsigned int alignment,
+    unsigned int size, unsigned int arrayCount)
+  {
+    //array elements and structs are rounded up to a vec4
+    unsigned int stride = size;
+    if(arrayCount > 0 || type == 0)
+    {
+      alignment = Align(alignment, 16);
+      stride = Align(size, 16);
+    }
+    UniformBlockElement element = { name, type, Align(m_Size, alignment), size,
+      arrayCount, arrayCount > 0 ? stride : 0 };
+    m_Elements.push_back(element);
+    m_Size = element.offset + (arrayCount > 0 ? stride * arrayCount : stride);
+    //whatever follows an array or a struct starts on a vec4 boundary
+    if(arrayCount > 0 || type == 0)
+      m_Size = Align(m_Size, 16);
+    return (unsigned int)m_Elements.size() - 1;
+  }
+
+public:
+  UniformBlockLayout()
+    : m_Size(0) {};
+
+  template<typename T>
+  unsigned int Push(const std::string& name, unsigned int arrayCount = 0)
+  {
+    return Add(name, UniformType<T>::type, UniformType<T>::alignment, sizeof(T), arrayCount);
+  }
+
+  //nested struct member, its own members are written through layout.Write
+  //at GetOffset(index) of this block
+  unsigned int PushStruct(const std::string& name, const UniformBlockLayout& layout,
+    unsigned int arrayCount = 0)
+  {
+    return Add(name, 0, 16, layout.GetSize(), arrayCount);
+  }
+
+  //index of a member, -1 if there is none with that name
+  int Find(const std::string& name) const
+  {
+    for(unsigned int i = 0; i < m_Elements.size(); i++)
+    {
+      if(m_Elements[i].name == name)
+        return (int)i;
+    }
+    return -1;
+  }
+
+  unsigned int GetOffset(unsigned int index, unsigned int arrayIndex = 0) const
+  {
+    const UniformBlockElement& element = m_Elements[index];
+    ASSERT(arrayIndex == 0 || arrayIndex < element.arrayCount);
+    return element.offset + arrayIndex * element.arrayStride;
+  }
+
+  //copies value to its std140 position inside block, which is GetSize() bytes
+  template<typename T>
+  void Write(void* block, unsigned int index, const T& value, unsigned int arrayIndex = 0) const
+  {
+    ASSERT(m_Elements[index].type == UniformType<T>::type);
+    memcpy((unsigned char*)block + GetOffset(index, arrayIndex), &value, sizeof(T));
+  }
+
+  inline const std::vector<UniformBlockElement>&
+    GetElements() const {return m_Elements;};
+  //a block's size is a multiple of a vec4, like the one glGetActiveUniformBlockiv reports
+  inline unsigned int GetSize () const {return Align(m_Size, 16);};
+};
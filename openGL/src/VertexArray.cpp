@@ -1,10 +1,14 @@
 #pragma once
 #include "VertexArray.h"
 #include "Renderer.h"
+#include <iostream>
 
 VertexArray::VertexArray()
+  : m_AttribCount(0), m_FedLocations(0)
 {
   GLCALL(glGenVertexArrays(1, &m_RendererId));
+  for(unsigned int i = 0; i < MAX_BINDINGS; i++)
+    m_BindingStrides[i] = 0;
 };
 
 VertexArray::~VertexArray()
@@ -12,21 +16,149 @@ VertexArray::~VertexArray()
   GLCALL(glDeleteVertexArrays(1, &m_RendererId));
 };
 
-void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout, unsigned int divisor)
+{
+  const auto& elements = layout.GetElements();
+  AddBuffer(vb, elements.data(), (unsigned int)elements.size(), layout.GetStride(), divisor);
+}
+
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferElement* elements,
+  unsigned int count, unsigned int stride, unsigned int divisor)
 {
   Bind();
   vb.Bind();
+  for(unsigned int i = 0; i < count; i++)
+  {
+    const auto& element = elements[i];
+    const unsigned int index = m_AttribCount++;
+    m_FedLocations |= 1ull << index;
+    GLCALL(glEnableVertexAttribArray(index));
+    GLCALL(glVertexAttribPointer(index, element.count, element.type, 
+      element.normalized, stride, (const void*)(size_t)element.offset));
+    if(divisor != 0)
+    {
+      GLCALL(glVertexAttribDivisor(index, divisor));
+    }
+  }
+  
+}
+
+static bool IsIntegerElement(unsigned int type)
+{
+  switch(type)
+  {
+    case GL_BYTE: case GL_UNSIGNED_BYTE: case GL_SHORT: case GL_UNSIGNED_SHORT:
+    case GL_INT: case GL_UNSIGNED_INT:
+      return true;
+  }
+  return false;
+}
+
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout,
+  const ShaderReflection& reflection, unsigned int divisor)
+{
   const auto& elements = layout.GetElements();
-  unsigned int offset = 0;
+  Bind();
+  vb.Bind();
   for(unsigned int i = 0; i < elements.size(); i++)
   {
     const auto& element = elements[i];
-    GLCALL(glEnableVertexAttribArray(i));
-    GLCALL(glVertexAttribPointer(i, element.count, element.type, 
-      element.normalized, layout.GetStride() , (const void*) offset));
-    offset += element.count * VertexBufferElement::GetSizeOftype(element.type);
+    if(!element.name)
+    {
+      std::cout << "Warning: unnamed vertex attribute " << i << " can't be matched to the shader" << std::endl;
+      continue;
+    }
+    const ShaderReflection::Attribute* attribute = reflection.FindAttribute(element.name);
+    if(!attribute)
+      continue; //not read by the shader
+
+    //matrices take one location per column, each column holds count / columns components
+    const unsigned int columns = ShaderReflection::GetLocationCount(attribute->type);
+    const unsigned int components = element.count / columns;
+    if(ShaderReflection::GetComponentCount(attribute->type) == 0 || components * columns != element.count)
+    {
+      std::cout << "Warning: vertex attribute " << element.name << " doesn't fit the shader input" << std::endl;
+      continue;
+    }
+    //int inputs read garbage through glVertexAttribPointer, they need the I variant,
+    //which only takes unnormalized integer data
+    const bool integer = ShaderReflection::IsIntegerType(attribute->type);
+    if(integer && (!IsIntegerElement(element.type) || element.normalized))
+    {
+      std::cout << "Warning: vertex attribute " << element.name << " feeds an integer shader input with "
+        << (element.normalized ? "normalized" : "float") << " data" << std::endl;
+      continue;
+    }
+    //packed formats can't be split into columns
+    const unsigned int columnSize = columns == 1 ? 0 : VertexBufferElement::GetSize(element.type, components);
+
+    for(unsigned int c = 0; c < columns; c++)
+    {
+      const unsigned int index = attribute->location + c;
+      const void* offset = (const void*)(size_t)(element.offset + c * columnSize);
+      m_FedLocations |= 1ull << index;
+      GLCALL(glEnableVertexAttribArray(index));
+      if(integer)
+      {
+        GLCALL(glVertexAttribIPointer(index, components, element.type, layout.GetStride(), offset));
+      }
+      else
+      {
+        GLCALL(glVertexAttribPointer(index, components, element.type,
+          element.normalized, layout.GetStride(), offset));
+      }
+      if(divisor != 0)
+      {
+        GLCALL(glVertexAttribDivisor(index, divisor));
+      }
+      if(index + 1 > m_AttribCount)
+        m_AttribCount = index + 1;
+    }
   }
-  
+
+  for(unsigned int i = 0; i < reflection.Attributes.size(); i++)
+  {
+    const ShaderReflection::Attribute& attribute = reflection.Attributes[i];
+    if(attribute.location < 64 && !(m_FedLocations & (1ull << attribute.location)))
+      std::cout << "Warning: shader input " << attribute.name << " isn't fed by any vertex attribute" << std::endl;
+  }
+}
+
+bool VertexArray::IsFormatBindingSupported()
+{
+  return GLEW_VERSION_4_3 || GLEW_ARB_vertex_attrib_binding;
+}
+
+void VertexArray::SetFormat(const VertexBufferLayout& layout, unsigned int binding, unsigned int divisor)
+{
+  const auto& elements = layout.GetElements();
+  SetFormat(elements.data(), (unsigned int)elements.size(), layout.GetStride(), binding, divisor);
+}
+
+void VertexArray::SetFormat(const VertexBufferElement* elements, unsigned int count,
+  unsigned int stride, unsigned int binding, unsigned int divisor)
+{
+  ASSERT(IsFormatBindingSupported());
+  ASSERT(binding < MAX_BINDINGS);
+  m_BindingStrides[binding] = stride;
+  Bind();
+  for(unsigned int i = 0; i < count; i++)
+  {
+    const auto& element = elements[i];
+    const unsigned int index = m_AttribCount++;
+    m_FedLocations |= 1ull << index;
+    GLCALL(glEnableVertexAttribArray(index));
+    GLCALL(glVertexAttribFormat(index, element.count, element.type,
+      element.normalized, element.offset));
+    GLCALL(glVertexAttribBinding(index, binding));
+  }
+  GLCALL(glVertexBindingDivisor(binding, divisor));
+}
+
+void VertexArray::BindVertexBuffer(const VertexBuffer& vb, unsigned int binding, unsigned int offset) const
+{
+  ASSERT(binding < MAX_BINDINGS && m_BindingStrides[binding] != 0);
+  GLCALL(glBindVertexBuffer(binding, vb.GetRendererId(), offset, m_BindingStrides[binding]));
 }
 
 void VertexArray::Bind() const
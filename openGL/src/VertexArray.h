@@ -1,17 +1,63 @@
 #pragma once
 #include "VertexBuffer.h"
 #include "VertexBufferLayout.h"
+#include "ShaderReflection.h"
 class VertexArray
 {
 private:
+  static const unsigned int MAX_BINDINGS = 16;
+
   unsigned int m_RendererId;
+  unsigned int m_BindingStrides[MAX_BINDINGS];
+  //next free attribute index, every added stream continues where the last one stopped
+  unsigned int m_AttribCount;
+  //bit i set once attribute location i has a stream
+  unsigned long long m_FedLocations;
+
+  void AddBuffer(const VertexBuffer& vb, const VertexBufferElement* elements,
+    unsigned int count, unsigned int stride, unsigned int divisor);
+  void SetFormat(const VertexBufferElement* elements, unsigned int count,
+    unsigned int stride, unsigned int binding, unsigned int divisor);
 
 public:
 
   VertexArray();
   ~VertexArray();
 
-  void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
+  //each call adds a stream. divisor 0 advances per vertex, n advances every n instances
+  void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout, unsigned int divisor = 0);
+
+  template<typename... Attrs>
+  void AddBuffer(const VertexBuffer& vb, const Layout<Attrs...>& layout, unsigned int divisor = 0)
+  {
+    AddBuffer(vb, layout.GetElements(), Layout<Attrs...>::Count, layout.GetStride(), divisor);
+  }
+
+  //binds every named element to the location of the shader input with the same name.
+  //elements the shader doesn't use are skipped, so they are never fetched;
+  //mismatching elements and shader inputs no stream of this VAO feeds yet are reported,
+  //so with several streams add the one with the shader's inputs last
+  void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout,
+    const ShaderReflection& reflection, unsigned int divisor = 0);
+
+  //separate format and buffer (GL 4.3 / ARB_vertex_attrib_binding): the attributes are
+  //described once per binding, meshes of the same format then only swap the buffer
+  static bool IsFormatBindingSupported();
+
+  void SetFormat(const VertexBufferLayout& layout, unsigned int binding = 0, unsigned int divisor = 0);
+
+  template<typename... Attrs>
+  void SetFormat(const Layout<Attrs...>& layout, unsigned int binding = 0, unsigned int divisor = 0)
+  {
+    SetFormat(layout.GetElements(), Layout<Attrs...>::Count, layout.GetStride(), binding, divisor);
+  }
+
+  //attaches vb to a binding set up by SetFormat, the VAO must be bound
+  void BindVertexBuffer(const VertexBuffer& vb, unsigned int binding = 0, unsigned int offset = 0) const;
+
   void Bind() const;
   void UnBind() const;
+
+  inline unsigned int GetAttribCount () const {return m_AttribCount;}
+  inline unsigned int GetRendererId () const {return m_RendererId;}
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "VertexArrayCache.h"
+
+static bool SameElements(const std::vector<VertexBufferElement>& a, const std::vector<VertexBufferElement>& b)
+{
+  if(a.size() != b.size())
+    return false;
+  for(unsigned int i = 0; i < a.size(); i++)
+  {
+    if(a[i].type != b[i].type || a[i].count != b[i].count ||
+      a[i].normalized != b[i].normalized || a[i].offset != b[i].offset)
+      return false;
+  }
+  return true;
+}
+
+VertexArrayCache::VertexArrayCache(unsigned int capacity)
+  : m_Capacity(capacity)
+{
+  ASSERT(capacity > 0);
+}
+
+std::shared_ptr<const VertexArray> VertexArrayCache::Acquire(const VertexBuffer& vb, const VertexBufferLayout& layout,
+  const IndexBuffer* ib)
+{
+  return Acquire(layout, &vb, ib);
+}
+
+std::shared_ptr<const VertexArray> VertexArrayCache::AcquireFormat(const VertexBufferLayout& layout)
+{
+  return Acquire(layout, nullptr, nullptr);
+}
+
+std::shared_ptr<const VertexArray> VertexArrayCache::Acquire(const VertexBufferLayout& layout, const VertexBuffer* vb,
+  const IndexBuffer* ib)
+{
+  //buffer id 0 is never generated, so format-only entries cannot clash with buffer entries
+  Key key = { layout.GetHash(), vb ? vb->GetRendererId() : 0, ib ? ib->GetRendererId() : 0 };
+
+  auto found = m_Lookup.find(key);
+  if(found != m_Lookup.end())
+  {
+    EntryList::iterator entry = found->second;
+    if(SameElements(entry->elements, layout.GetElements()))
+    {
+      m_Entries.splice(m_Entries.begin(), m_Entries, entry);
+      return entry->vertexArray;
+    }
+    //same hash but a different layout, rebuild the slot
+    m_Entries.erase(entry);
+    m_Lookup.erase(found);
+  }
+
+  if(m_Entries.size() >= m_Capacity)
+  {
+    m_Lookup.erase(m_Entries.back().key);
+    m_Entries.pop_back();
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.elements = layout.GetElements();
+  std::shared_ptr<VertexArray> vertexArray = std::make_shared<VertexArray>();
+  if(vb)
+    vertexArray->AddBuffer(*vb, layout);
+  else
+    vertexArray->SetFormat(layout);
+  //the element array binding is part of the VAO state
+  if(ib)
+    ib->Bind();
+  vertexArray->UnBind();
+  entry.vertexArray = vertexArray;
+
+  m_Entries.push_front(std::move(entry));
+  m_Lookup[key] = m_Entries.begin();
+  return m_Entries.front().vertexArray;
+}
+
+void VertexArrayCache::Evict(const VertexBuffer& vb)
+{
+  for(EntryList::iterator it = m_Entries.begin(); it != m_Entries.end();)
+  {
+    if(it->key.vertexBuffer == vb.GetRendererId())
+    {
+      m_Lookup.erase(it->key);
+      it = m_Entries.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+void VertexArrayCache::Evict(const IndexBuffer& ib)
+{
+  for(EntryList::iterator it = m_Entries.begin(); it != m_Entries.end();)
+  {
+    if(it->key.indexBuffer == ib.GetRendererId())
+    {
+      m_Lookup.erase(it->key);
+      it = m_Entries.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+void VertexArrayCache::Clear()
+{
+  m_Lookup.clear();
+  m_Entries.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "VertexArray.h"
+#include "IndexBuffer.h"
+
+//shares one VAO between every user of the same (layout, vertex buffer, index buffer)
+//combination. the least recently used VAO leaves the cache once it is full, holders
+//share ownership so it is only deleted when the last of them lets go (on the GL thread).
+class VertexArrayCache
+{
+private:
+  struct Key
+  {
+    unsigned long long layoutHash;
+    unsigned int vertexBuffer;
+    unsigned int indexBuffer;
+
+    bool operator==(const Key& other) const
+    {
+      return layoutHash == other.layoutHash && vertexBuffer == other.vertexBuffer &&
+        indexBuffer == other.indexBuffer;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const
+    {
+      unsigned long long h = key.layoutHash;
+      h = (h ^ key.vertexBuffer) * 1099511628211ull;
+      h = (h ^ key.indexBuffer) * 1099511628211ull;
+      return (size_t)(h ^ (h >> 32));
+    }
+  };
+
+  struct Entry
+  {
+    Key key;
+    std::vector<VertexBufferElement> elements; //guards against layout hash collisions
+    std::shared_ptr<const VertexArray> vertexArray;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  EntryList m_Entries; //front is the most recently used
+  std::unordered_map<Key, EntryList::iterator, KeyHash> m_Lookup;
+  unsigned int m_Capacity;
+
+  std::shared_ptr<const VertexArray> Acquire(const VertexBufferLayout& layout, const VertexBuffer* vb,
+    const IndexBuffer* ib);
+
+public:
+  VertexArrayCache(unsigned int capacity = 256);
+
+  std::shared_ptr<const VertexArray> Acquire(const VertexBuffer& vb, const VertexBufferLayout& layout,
+    const IndexBuffer* ib = nullptr);
+
+  //format-only VAO shared by every mesh with this layout, attach the mesh with
+  //BindVertexBuffer() and bind its index buffer after binding the VAO
+  std::shared_ptr<const VertexArray> AcquireFormat(const VertexBufferLayout& layout);
+
+  //must be called before a buffer is deleted, GL may hand its id out again
+  void Evict(const VertexBuffer& vb);
+  void Evict(const IndexBuffer& ib);
+  void Clear();
+
+  inline unsigned int GetSize () const {return (unsigned int)m_Entries.size();}
+};
@@ -2,6 +2,7 @@
 #include "Renderer.h"
 
 VertexBuffer::VertexBuffer(const void* data, unsigned int size) 
+  : m_Size(size)
 {
     GLCALL(glGenBuffers(1, &m_RendererId));
     GLCALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererId));
@@ -9,6 +10,14 @@ VertexBuffer::VertexBuffer(const void* data, unsigned int size)
 
 }
 
+VertexBuffer::VertexBuffer(unsigned int size)
+  : m_Size(size)
+{
+    GLCALL(glGenBuffers(1, &m_RendererId));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererId));
+    GLCALL(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+}
+
 VertexBuffer::~VertexBuffer()
 {
   GLCALL(glDeleteBuffers(1, &m_RendererId));
@@ -22,4 +31,12 @@ void VertexBuffer::Bind() const
 void VertexBuffer::Unbind() const
 {
   GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
-}
\ No newline at end of file
+}
+
+void VertexBuffer::SetData(const void* data, unsigned int size)
+{
+  ASSERT(size <= m_Size);
+  GLCALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererId));
+  GLCALL(glBufferData(GL_ARRAY_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW));
+  GLCALL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
+}
@@ -3,13 +3,22 @@ class VertexBuffer
 {
 public:
   VertexBuffer(const void* data, unsigned int size);
+  //empty GL_DYNAMIC_DRAW buffer whose contents are replaced with SetData
+  VertexBuffer(unsigned int size);
   ~VertexBuffer(void);
 
 
   void Bind() const;
   void Unbind() const;
+
+  //orphans the old storage and uploads size bytes, so draws still reading the
+  //previous contents don't stall the cpu. binds the buffer
+  void SetData(const void* data, unsigned int size);
+
+  inline unsigned int GetRendererId () const {return m_RendererId;}
 private:
   unsigned int m_RendererId;
+  unsigned int m_Size;
 
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <utility>
 #include <glew.h>
 #include "Renderer.h"
 
@@ -8,6 +9,9 @@ struct VertexBufferElement
   unsigned int type;
   unsigned int count;
   unsigned char normalized;
+  unsigned int offset;
+  //shader input it feeds when added with a ShaderReflection, usually a literal
+  const char* name = nullptr;
 
   static unsigned int GetSizeOftype(unsigned int type)
   {
@@ -16,10 +20,87 @@ struct VertexBufferElement
       case GL_FLOAT: return 4;
       case GL_UNSIGNED_BYTE: return 1;
       case GL_UNSIGNED_INT: return 4;
+      case GL_HALF_FLOAT: return 2;
+      case GL_SHORT: return 2;
+      case GL_UNSIGNED_SHORT: return 2;
+      case GL_INT_2_10_10_10_REV: return 4;
+      case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
     }
     ASSERT(false);
     return 0;
   }
+
+  static bool IsPackedType(unsigned int type)
+  {
+    return type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV;
+  }
+
+  //size in bytes of count components, packed types hold all 4 components in one value
+  static unsigned int GetSize(unsigned int type, unsigned int count)
+  {
+    if(IsPackedType(type))
+    {
+      ASSERT(count == 4);
+      return GetSizeOftype(type);
+    }
+    return count * GetSizeOftype(type);
+  }
+};
+
+//maps a C++ type to its GL attribute type, unsupported types fail to compile
+template<typename T>
+struct VertexAttribType
+{
+  static_assert(sizeof(T) == 0, "unsupported vertex attribute type");
+};
+
+template<> struct VertexAttribType<float>
+{
+  static constexpr unsigned int type = GL_FLOAT;
+  static constexpr unsigned char normalized = GL_FALSE;
+};
+template<> struct VertexAttribType<unsigned int>
+{
+  static constexpr unsigned int type = GL_UNSIGNED_INT;
+  static constexpr unsigned char normalized = GL_FALSE;
+};
+template<> struct VertexAttribType<unsigned char>
+{
+  static constexpr unsigned int type = GL_UNSIGNED_BYTE;
+  static constexpr unsigned char normalized = GL_TRUE;
+};
+template<> struct VertexAttribType<char> : VertexAttribType<unsigned char> {};
+template<> struct VertexAttribType<short>
+{
+  static constexpr unsigned int type = GL_SHORT;
+  static constexpr unsigned char normalized = GL_TRUE;
+};
+template<> struct VertexAttribType<unsigned short>
+{
+  static constexpr unsigned int type = GL_UNSIGNED_SHORT;
+  static constexpr unsigned char normalized = GL_TRUE;
+};
+
+//storage types of the compact formats, filled by the kernels in VertexQuantize.h
+struct HalfFloat
+{
+  unsigned short bits;
+};
+//signed normalized x, y, z in 10 bits each and w in the top 2 bits
+struct PackedNormal
+{
+  unsigned int bits;
+};
+
+template<> struct VertexAttribType<HalfFloat>
+{
+  static constexpr unsigned int type = GL_HALF_FLOAT;
+  static constexpr unsigned char normalized = GL_FALSE;
+};
+template<> struct VertexAttribType<PackedNormal>
+{
+  static constexpr unsigned int type = GL_INT_2_10_10_10_REV;
+  static constexpr unsigned char normalized = GL_TRUE;
 };
 
 class VertexBufferLayout
@@ -27,40 +108,90 @@ class VertexBufferLayout
 private:
   std::vector<VertexBufferElement> m_Elements;
   unsigned int m_stride;
+  unsigned long long m_Hash;
+
+  void HashValue(unsigned int value)
+  {
+    //FNV-1a, one byte at a time
+    for(unsigned int i = 0; i < 4; i++)
+      m_Hash = (m_Hash ^ ((value >> (i * 8)) & 0xff)) * 1099511628211ull;
+  }
 
 public:
   VertexBufferLayout()
-    : m_stride(0) {};
-  
+    : m_stride(0), m_Hash(14695981039346656037ull) {};
+
+  //name must outlive the layout, e.g. Push<float>(3, "position")
   template<typename T>
-  void Push(int count)
+  void Push(unsigned int count, const char* name = nullptr)
   {
-    static_assert(false);
+    Push(VertexAttribType<T>::type, count, VertexAttribType<T>::normalized, name);
   }
 
-  template<>
-  void Push<float>(int count)
+  void Push(unsigned int type, unsigned int count, unsigned char normalized, const char* name = nullptr)
   {
-    VertexBufferElement a = { GL_FLOAT, count, GL_FALSE };
-    m_Elements.push_back(a);
-    m_stride += (count * VertexBufferElement::GetSizeOftype(GL_FLOAT));
+    VertexBufferElement element = { type, count, normalized, m_stride, name };
+    m_Elements.push_back(element);
+    m_stride += VertexBufferElement::GetSize(type, count);
+    HashValue(type);
+    HashValue(count);
+    HashValue(normalized);
   }
-  template<>
-  void Push<unsigned int>(int count)
+
+  inline const std::vector<VertexBufferElement>&
+    GetElements() const {return m_Elements;};
+  inline unsigned int GetStride () const {return m_stride;};
+  //covers every element, offsets and the stride follow from them
+  inline unsigned long long GetHash () const {return m_Hash;};
+};
+
+//compile-time layout, e.g. Layout<Attr<float, 3>, Attr<unsigned char, 4, Normalized>>.
+//stride, offsets and GL formats are constants, so setting up attributes needs no allocation.
+static constexpr unsigned char Normalized = GL_TRUE;
+
+template<typename T, unsigned int Count, unsigned char Norm = VertexAttribType<T>::normalized>
+struct Attr
+{
+  static constexpr unsigned int type = VertexAttribType<T>::type;
+  static constexpr unsigned int count = Count;
+  static constexpr unsigned char normalized = Norm;
+  static constexpr bool packed = type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV;
+  static constexpr unsigned int size = packed ? sizeof(T) : Count * sizeof(T);
+  static_assert(!packed || Count == 4, "packed formats have 4 components");
+};
+
+template<typename... Attrs>
+struct Layout
+{
+  static_assert(sizeof...(Attrs) > 0, "a layout needs at least one attribute");
+
+  static constexpr unsigned int Count = sizeof...(Attrs);
+  static constexpr unsigned int Stride = (Attrs::size + ...);
+
+  //offset of attribute I, the sum of the sizes in front of it
+  template<unsigned int I>
+  static constexpr unsigned int Offset()
   {
-    VertexBufferElement a = { GL_UNSIGNED_INT, count, GL_FALSE};
-    m_Elements.push_back(a);
-    m_stride += (count * VertexBufferElement::GetSizeOftype(GL_UNSIGNED_INT));
+    static_assert(I < Count, "attribute index out of range");
+    constexpr unsigned int sizes[] = { Attrs::size... };
+    unsigned int offset = 0;
+    for(unsigned int i = 0; i < I; i++)
+      offset += sizes[i];
+    return offset;
   }
-  template<>
-  void Push<char>(int count)
+
+private:
+  template<typename Sequence>
+  struct Table;
+  template<unsigned int... I>
+  struct Table<std::integer_sequence<unsigned int, I...>>
   {
-    VertexBufferElement a = { GL_UNSIGNED_BYTE, count, GL_TRUE };
-    m_Elements.push_back(a);
-    m_stride += (count * VertexBufferElement::GetSizeOftype(GL_UNSIGNED_BYTE));
-  }
+    static constexpr VertexBufferElement Elements[] = {
+      { Attrs::type, Attrs::count, Attrs::normalized, Offset<I>() }... };
+  };
+  typedef Table<std::make_integer_sequence<unsigned int, sizeof...(Attrs)>> ElementTable;
 
-  inline const std::vector<VertexBufferElement> 
-    GetElements() const {return m_Elements;};
-  inline unsigned int GetStride () const {return m_stride;};
-};
\ No newline at end of file
+public:
+  static constexpr const VertexBufferElement* GetElements() { return ElementTable::Elements; }
+  static constexpr unsigned int GetStride() { return Stride; }
+};
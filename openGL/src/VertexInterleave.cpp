@@ -0,0 +1,182 @@
+#include "VertexInterleave.h"
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define INTERLEAVE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define INTERLEAVE_AVX2
+#include <immintrin.h>
+#endif
+
+//attributes are copied with the next power of two wide move. the extra bytes
+//spill into the following attribute or vertex, which is written afterwards,
+//or into a gap, which is zeroed once the vertex is done. so only the last few
+//vertices need an exact copy.
+struct CopyOp
+{
+  unsigned int offset;
+  unsigned int size;
+  unsigned int width;
+};
+
+//bytes of a vertex no element covers: in front of the first one, between two, or the padding at the end
+struct Gap
+{
+  unsigned int offset;
+  unsigned int size;
+};
+
+static void FindGaps(const std::vector<CopyOp>& ops, unsigned int stride, std::vector<Gap>& gaps)
+{
+  unsigned int end = 0;
+  for(const CopyOp& op : ops)
+  {
+    if(op.offset > end)
+      gaps.push_back({ end, op.offset - end });
+    end = op.offset + op.size;
+  }
+  if(stride > end)
+    gaps.push_back({ end, stride - end });
+}
+
+static inline void ZeroGaps(unsigned char* vertex, const std::vector<Gap>& gaps)
+{
+  for(const Gap& gap : gaps)
+    memset(vertex + gap.offset, 0, gap.size);
+}
+
+static unsigned int CopyWidth(unsigned int size)
+{
+  if(size > 32)
+    return size;
+  unsigned int width = 1;
+  while(width < size)
+    width <<= 1;
+  return width;
+}
+
+static inline void CopyWide(unsigned char* dst, const unsigned char* src, unsigned int width)
+{
+  switch(width)
+  {
+    case 1: *dst = *src; return;
+    case 2: memcpy(dst, src, 2); return;
+    case 4: memcpy(dst, src, 4); return;
+    case 8: memcpy(dst, src, 8); return;
+#ifdef INTERLEAVE_SSE2
+    case 16:
+      _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+      return;
+#endif
+#if defined(INTERLEAVE_AVX2)
+    case 32:
+      _mm256_storeu_si256((__m256i*)dst, _mm256_loadu_si256((const __m256i*)src));
+      return;
+#elif defined(INTERLEAVE_SSE2)
+    case 32:
+    {
+      __m128i a = _mm_loadu_si128((const __m128i*)src);
+      __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+      _mm_storeu_si128((__m128i*)dst, a);
+      _mm_storeu_si128((__m128i*)(dst + 16), b);
+      return;
+    }
+#endif
+  }
+  memcpy(dst, src, width);
+}
+
+//builds the copy list and returns how many leading vertices can use the wide copies
+static unsigned int PrepareOps(const VertexBufferElement* elements, unsigned int elementCount,
+  unsigned int stride, unsigned int vertexCount, std::vector<CopyOp>& ops)
+{
+  ops.resize(elementCount);
+  unsigned long long safe = vertexCount;
+  const unsigned long long total = (unsigned long long)vertexCount * stride;
+  for(unsigned int e = 0; e < elementCount; e++)
+  {
+    CopyOp& op = ops[e];
+    op.offset = elements[e].offset;
+    op.size = VertexBufferElement::GetSize(elements[e].type, elements[e].count);
+    op.width = CopyWidth(op.size);
+    ASSERT(e == 0 || op.offset >= ops[e - 1].offset + ops[e - 1].size);
+    ASSERT(op.offset + op.size <= stride);
+
+    //interleaved side: v * stride + offset + width <= total
+    unsigned long long end = op.offset + op.width;
+    unsigned long long limit = total >= end ? (total - end) / stride + 1 : 0;
+    if(limit < safe)
+      safe = limit;
+    //stream side: v * size + width <= vertexCount * size
+    end = (unsigned long long)vertexCount * op.size;
+    limit = end >= op.width ? (end - op.width) / op.size + 1 : 0;
+    if(limit < safe)
+      safe = limit;
+  }
+  return (unsigned int)safe;
+}
+
+void InterleaveStreams(const void* const* streams, const VertexBufferElement* elements,
+  unsigned int elementCount, unsigned int stride, unsigned int vertexCount, void* dst)
+{
+  std::vector<CopyOp> ops;
+  const unsigned int safe = PrepareOps(elements, elementCount, stride, vertexCount, ops);
+  std::vector<Gap> gaps;
+  FindGaps(ops, stride, gaps);
+  unsigned char* out = (unsigned char*)dst;
+
+  for(unsigned int v = 0; v < safe; v++)
+  {
+    unsigned char* vertex = out + (size_t)v * stride;
+    for(unsigned int e = 0; e < elementCount; e++)
+    {
+      const CopyOp& op = ops[e];
+      CopyWide(vertex + op.offset, (const unsigned char*)streams[e] + (size_t)v * op.size, op.width);
+    }
+    //the copies never reach back, so the gaps of this vertex are final after this
+    ZeroGaps(vertex, gaps);
+  }
+  for(unsigned int v = safe; v < vertexCount; v++)
+  {
+    unsigned char* vertex = out + (size_t)v * stride;
+    for(unsigned int e = 0; e < elementCount; e++)
+      memcpy(vertex + ops[e].offset, (const unsigned char*)streams[e] + (size_t)v * ops[e].size, ops[e].size);
+    ZeroGaps(vertex, gaps);
+  }
+}
+
+void DeinterleaveStreams(const void* src, const VertexBufferElement* elements,
+  unsigned int elementCount, unsigned int stride, unsigned int vertexCount, void* const* streams)
+{
+  std::vector<CopyOp> ops;
+  const unsigned int safe = PrepareOps(elements, elementCount, stride, vertexCount, ops);
+  const unsigned char* in = (const unsigned char*)src;
+
+  //stream-major here: a stream's spill must land on values that are written later
+  for(unsigned int e = 0; e < elementCount; e++)
+  {
+    const CopyOp& op = ops[e];
+    unsigned char* stream = (unsigned char*)streams[e];
+    for(unsigned int v = 0; v < safe; v++)
+      CopyWide(stream + (size_t)v * op.size, in + (size_t)v * stride + op.offset, op.width);
+    for(unsigned int v = safe; v < vertexCount; v++)
+      memcpy(stream + (size_t)v * op.size, in + (size_t)v * stride + op.offset, op.size);
+  }
+}
+
+void InterleaveStreams(const void* const* streams, const VertexBufferLayout& layout,
+  unsigned int vertexCount, void* dst)
+{
+  const auto& elements = layout.GetElements();
+  InterleaveStreams(streams, elements.data(), (unsigned int)elements.size(), layout.GetStride(), vertexCount, dst);
+}
+
+void DeinterleaveStreams(const void* src, const VertexBufferLayout& layout,
+  unsigned int vertexCount, void* const* streams)
+{
+  const auto& elements = layout.GetElements();
+  DeinterleaveStreams(src, elements.data(), (unsigned int)elements.size(), layout.GetStride(), vertexCount, streams);
+}
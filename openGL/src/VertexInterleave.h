@@ -0,0 +1,32 @@
+#pragma once
+#include "VertexBufferLayout.h"
+
+//SoA <-> AoS conversion driven by a layout. streams[i] holds vertexCount
+//tightly packed values of element i, dst/src is the interleaved buffer that
+//VertexArray::AddBuffer expects. AVX2/SSE2 copies are used when available.
+//interleaving writes every byte of dst: bytes no element covers (gaps between
+//elements and the padding up to the stride) are zeroed.
+void InterleaveStreams(const void* const* streams, const VertexBufferLayout& layout,
+  unsigned int vertexCount, void* dst);
+void DeinterleaveStreams(const void* src, const VertexBufferLayout& layout,
+  unsigned int vertexCount, void* const* streams);
+
+//same for compile-time layouts
+void InterleaveStreams(const void* const* streams, const VertexBufferElement* elements,
+  unsigned int elementCount, unsigned int stride, unsigned int vertexCount, void* dst);
+void DeinterleaveStreams(const void* src, const VertexBufferElement* elements,
+  unsigned int elementCount, unsigned int stride, unsigned int vertexCount, void* const* streams);
+
+template<typename... Attrs>
+void InterleaveStreams(const void* const* streams, const Layout<Attrs...>& layout,
+  unsigned int vertexCount, void* dst)
+{
+  InterleaveStreams(streams, layout.GetElements(), Layout<Attrs...>::Count, layout.GetStride(), vertexCount, dst);
+}
+
+template<typename... Attrs>
+void DeinterleaveStreams(const void* src, const Layout<Attrs...>& layout,
+  unsigned int vertexCount, void* const* streams)
+{
+  DeinterleaveStreams(src, layout.GetElements(), Layout<Attrs...>::Count, layout.GetStride(), vertexCount, streams);
+}
@@ -0,0 +1,162 @@
+#include "VertexQuantize.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define QUANTIZE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define QUANTIZE_F16C
+#include <immintrin.h>
+#endif
+
+//round to nearest even, handles denormals, inf and nan
+static unsigned short FloatToHalf(float value)
+{
+  const unsigned int f32infty = 255u << 23;
+  const unsigned int f16max = (127u + 16u) << 23;
+  const unsigned int denormMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+  unsigned int f;
+  memcpy(&f, &value, 4);
+  const unsigned int sign = f & 0x80000000u;
+  f ^= sign;
+
+  unsigned short o;
+  if(f >= f16max)
+    o = (f > f32infty) ? 0x7e00 : 0x7c00;
+  else if(f < (113u << 23))
+  {
+    //let the float adder do the rounding into the denormal range
+    float v, magic;
+    memcpy(&v, &f, 4);
+    memcpy(&magic, &denormMagicBits, 4);
+    v += magic;
+    memcpy(&f, &v, 4);
+    o = (unsigned short)(f - denormMagicBits);
+  }
+  else
+  {
+    const unsigned int mantissaOdd = (f >> 13) & 1;
+    f += ((unsigned int)(15 - 127) << 23) + 0xfff;
+    f += mantissaOdd;
+    o = (unsigned short)(f >> 13);
+  }
+  return (unsigned short)(o | (sign >> 16));
+}
+
+static float Clamp(float v, float lo, float hi)
+{
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+//same rule as _mm_cvtps_epi32 (nearest even under the default rounding mode),
+//so a value quantizes the same whether it lands in a SIMD block or the tail
+static int Round(float v)
+{
+  return (int)std::lrint(v);
+}
+
+void QuantizeHalf(const float* src, HalfFloat* dst, size_t count)
+{
+  size_t i = 0;
+#ifdef QUANTIZE_F16C
+  for(; i + 8 <= count; i += 8)
+  {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), 0); //0 = round to nearest even
+    _mm_storeu_si128((__m128i*)(dst + i), h);
+  }
+#endif
+  for(; i < count; i++)
+    dst[i].bits = FloatToHalf(src[i]);
+}
+
+void QuantizeSnorm16(const float* src, short* dst, size_t count)
+{
+  size_t i = 0;
+#ifdef QUANTIZE_SSE2
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(32767.0f);
+  for(; i + 8 <= count; i += 8)
+  {
+    __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi), scale);
+    __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi), scale);
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128((__m128i*)(dst + i), packed);
+  }
+#endif
+  for(; i < count; i++)
+    dst[i] = (short)Round(Clamp(src[i], -1.0f, 1.0f) * 32767.0f);
+}
+
+void QuantizeUnorm16(const float* src, unsigned short* dst, size_t count)
+{
+  size_t i = 0;
+#ifdef QUANTIZE_SSE2
+  const __m128 lo = _mm_setzero_ps();
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(65535.0f);
+  //SSE2 only has a signed 32 -> 16 pack, so bias into the signed range and flip the sign bit back
+  const __m128i bias = _mm_set1_epi32(32768);
+  const __m128i flip = _mm_set1_epi16((short)0x8000);
+  for(; i + 8 <= count; i += 8)
+  {
+    __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi), scale);
+    __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi), scale);
+    __m128i ia = _mm_sub_epi32(_mm_cvtps_epi32(a), bias);
+    __m128i ib = _mm_sub_epi32(_mm_cvtps_epi32(b), bias);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi32(ia, ib), flip));
+  }
+#endif
+  for(; i < count; i++)
+    dst[i] = (unsigned short)Round(Clamp(src[i], 0.0f, 1.0f) * 65535.0f);
+}
+
+static unsigned int PackComponents(int x, int y, int z)
+{
+  return ((unsigned int)x & 0x3ff) | (((unsigned int)y & 0x3ff) << 10) | (((unsigned int)z & 0x3ff) << 20);
+}
+
+void QuantizeNormals(const float* src, PackedNormal* dst, size_t count)
+{
+  size_t i = 0;
+#ifdef QUANTIZE_SSE2
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(511.0f);
+  const __m128i mask = _mm_set1_epi32(0x3ff);
+  for(; i + 4 <= count; i += 4)
+  {
+    //4 normals are 12 floats: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+    const float* n = src + i * 3;
+    const __m128 a = _mm_loadu_ps(n);
+    const __m128 b = _mm_loadu_ps(n + 4);
+    const __m128 c = _mm_loadu_ps(n + 8);
+
+    //deinterleave into one register per component
+    const __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128 x = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+      _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+      _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    x = _mm_mul_ps(_mm_min_ps(_mm_max_ps(x, lo), hi), scale);
+    y = _mm_mul_ps(_mm_min_ps(_mm_max_ps(y, lo), hi), scale);
+    z = _mm_mul_ps(_mm_min_ps(_mm_max_ps(z, lo), hi), scale);
+
+    //2_10_10_10: x in bits 0-9, y in 10-19, z in 20-29, w = 0
+    __m128i bits = _mm_and_si128(_mm_cvtps_epi32(x), mask);
+    bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(_mm_cvtps_epi32(y), mask), 10));
+    bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(_mm_cvtps_epi32(z), mask), 20));
+    _mm_storeu_si128((__m128i*)(dst + i), bits);
+  }
+#endif
+  for(; i < count; i++)
+  {
+    const float* n = src + i * 3;
+    dst[i].bits = PackComponents(Round(Clamp(n[0], -1.0f, 1.0f) * 511.0f),
+      Round(Clamp(n[1], -1.0f, 1.0f) * 511.0f), Round(Clamp(n[2], -1.0f, 1.0f) * 511.0f));
+  }
+}
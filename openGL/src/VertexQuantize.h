@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include "VertexBufferLayout.h"
+
+//float -> compact vertex format converters. all of them round to nearest even,
+//so the absolute error is bounded by half a quantization step:
+//  half float   : relative error <= 2^-11 inside the half range
+//  snorm16      : <= 0.5 / 32767 after clamping to [-1, 1]
+//  unorm16      : <= 0.5 / 65535 after clamping to [0, 1]
+//  packed normal: <= 0.5 / 511 per component after clamping to [-1, 1]
+//SSE2 / F16C kernels are used when the target supports them.
+
+void QuantizeHalf(const float* src, HalfFloat* dst, size_t count);
+void QuantizeSnorm16(const float* src, short* dst, size_t count);
+void QuantizeUnorm16(const float* src, unsigned short* dst, size_t count);
+
+//src holds count xyz triples, w is stored as 0
+void QuantizeNormals(const float* src, PackedNormal* dst, size_t count);
@@ -0,0 +1,189 @@
+#include "VertexWelder.h"
+#include <cstring>
+#include <thread>
+
+//below this many vertices spinning up threads costs more than it saves
+static const unsigned int PARALLEL_THRESHOLD = 1 << 16;
+
+static unsigned int HashVertex(const unsigned char* v, unsigned int stride)
+{
+  //murmur style mixing, 4 bytes at a time
+  unsigned int h = 2166136261u;
+  unsigned int i = 0;
+  for(; i + 4 <= stride; i += 4)
+  {
+    unsigned int k;
+    memcpy(&k, v + i, 4);
+    k *= 0xcc9e2d51u;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593u;
+    h ^= k;
+    h = ((h << 13) | (h >> 19)) * 5 + 0xe6546b64u;
+  }
+  for(; i < stride; i++)
+    h = (h ^ v[i]) * 16777619u;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  return h;
+}
+
+static unsigned int GetThreadCount(unsigned int vertexCount)
+{
+  if(vertexCount < PARALLEL_THRESHOLD)
+    return 1;
+  unsigned int threads = std::thread::hardware_concurrency();
+  if(threads == 0)
+    threads = 1;
+  return threads > 16 ? 16 : threads;
+}
+
+template<typename Fn>
+static void ParallelFor(unsigned int threadCount, Fn fn)
+{
+  if(threadCount == 1)
+  {
+    fn(0u);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for(unsigned int t = 1; t < threadCount; t++)
+    workers.push_back(std::thread(fn, t));
+  fn(0u);
+  for(unsigned int t = 0; t < workers.size(); t++)
+    workers[t].join();
+}
+
+//fills remap[i] with the index of the first vertex that is byte-identical to vertex i
+static void BuildRemap(const unsigned char* data, unsigned int vertexCount,
+  unsigned int stride, std::vector<unsigned int>& remap)
+{
+  const unsigned int threadCount = GetThreadCount(vertexCount);
+  std::vector<unsigned int> hashes(vertexCount);
+  remap.resize(vertexCount);
+
+  //pass 1: hash every vertex, chunked across threads
+  ParallelFor(threadCount, [&](unsigned int t)
+  {
+    unsigned int begin = (unsigned int)((unsigned long long)vertexCount * t / threadCount);
+    unsigned int end = (unsigned int)((unsigned long long)vertexCount * (t + 1) / threadCount);
+    for(unsigned int i = begin; i < end; i++)
+      hashes[i] = HashVertex(data + (size_t)i * stride, stride);
+  });
+
+  //pass 2: every thread owns the vertices whose hash falls into its partition,
+  //so each open-addressing table is private and no locking is needed.
+  //vertices are visited in input order, so the first occurrence always wins.
+  ParallelFor(threadCount, [&](unsigned int t)
+  {
+    unsigned int capacity = 16;
+    while(capacity < (vertexCount / threadCount) * 2 + 1)
+      capacity <<= 1;
+    //slots hold vertex index + 1, 0 marks an empty slot
+    std::vector<unsigned int> table(capacity, 0);
+    const unsigned int mask = capacity - 1;
+    unsigned int used = 0;
+
+    for(unsigned int i = 0; i < vertexCount; i++)
+    {
+      const unsigned int h = hashes[i];
+      if(h % threadCount != t)
+        continue;
+
+      const unsigned char* v = data + (size_t)i * stride;
+      unsigned int slot = (h / threadCount) & mask;
+      for(;;)
+      {
+        const unsigned int entry = table[slot];
+        if(entry == 0)
+        {
+          table[slot] = i + 1;
+          remap[i] = i;
+          used++;
+          break;
+        }
+        const unsigned int other = entry - 1;
+        if(hashes[other] == h && memcmp(v, data + (size_t)other * stride, stride) == 0)
+        {
+          remap[i] = other;
+          break;
+        }
+        slot = (slot + 1) & mask; //linear probing
+      }
+
+      //keep the load factor at or below one half
+      if(used * 2 > capacity)
+      {
+        std::vector<unsigned int> old;
+        old.swap(table);
+        capacity <<= 1;
+        table.assign(capacity, 0);
+        const unsigned int newMask = capacity - 1;
+        for(unsigned int s = 0; s < old.size(); s++)
+        {
+          if(old[s] == 0)
+            continue;
+          unsigned int dst = (hashes[old[s] - 1] / threadCount) & newMask;
+          while(table[dst] != 0)
+            dst = (dst + 1) & newMask;
+          table[dst] = old[s];
+        }
+      }
+    }
+  });
+}
+
+static WeldedMesh Weld(const unsigned char* data, unsigned int vertexCount,
+  const unsigned int* indices, unsigned int indexCount, unsigned int stride)
+{
+  ASSERT(stride > 0);
+  std::vector<unsigned int> remap;
+  BuildRemap(data, vertexCount, stride, remap);
+
+  //compact the unique vertices, keeping their original order
+  WeldedMesh mesh;
+  mesh.VertexCount = 0;
+  std::vector<unsigned int> newIndex(vertexCount);
+  for(unsigned int i = 0; i < vertexCount; i++)
+  {
+    if(remap[i] == i)
+      newIndex[i] = mesh.VertexCount++;
+    else
+      newIndex[i] = newIndex[remap[i]];
+  }
+
+  mesh.Vertices.resize((size_t)mesh.VertexCount * stride);
+  for(unsigned int i = 0; i < vertexCount; i++)
+  {
+    if(remap[i] == i)
+      memcpy(&mesh.Vertices[(size_t)newIndex[i] * stride], data + (size_t)i * stride, stride);
+  }
+
+  if(indices)
+  {
+    mesh.Indices.resize(indexCount);
+    for(unsigned int i = 0; i < indexCount; i++)
+    {
+      ASSERT(indices[i] < vertexCount);
+      mesh.Indices[i] = newIndex[indices[i]];
+    }
+  }
+  else
+    mesh.Indices.swap(newIndex);
+
+  return mesh;
+}
+
+WeldedMesh WeldVertices(const void* vertices, unsigned int vertexCount,
+  const VertexBufferLayout& layout)
+{
+  return Weld((const unsigned char*)vertices, vertexCount, nullptr, 0, layout.GetStride());
+}
+
+WeldedMesh WeldVertices(const void* vertices, unsigned int vertexCount,
+  const unsigned int* indices, unsigned int indexCount,
+  const VertexBufferLayout& layout)
+{
+  return Weld((const unsigned char*)vertices, vertexCount, indices, indexCount, layout.GetStride());
+}
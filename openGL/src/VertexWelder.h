@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "VertexBufferLayout.h"
+
+//output of the welding stage, ready to be fed into VertexBuffer and IndexBuffer
+struct WeldedMesh
+{
+  std::vector<unsigned char> Vertices;
+  std::vector<unsigned int> Indices;
+  unsigned int VertexCount;
+};
+
+//removes byte-identical vertices from an unindexed vertex stream.
+//every vertex is layout.GetStride() bytes; the returned index buffer
+//has one entry per input vertex.
+WeldedMesh WeldVertices(const void* vertices, unsigned int vertexCount,
+  const VertexBufferLayout& layout);
+
+//same as above but for an already indexed stream, the indices are remapped
+WeldedMesh WeldVertices(const void* vertices, unsigned int vertexCount,
+  const unsigned int* indices, unsigned int indexCount,
+  const VertexBufferLayout& layout);
@@ -1,121 +1,41 @@
 #include <glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
-#include <fstream>
-#include <string>
-#include <sstream>
+#include <atomic>
+#include <thread>
 
 #include "Renderer.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 #include "VertexArray.h"
-
-struct ShaderProgramSource
+#include "TriangleStrip.h"
+#include "Shader.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderWatcher.h"
+#include "UniformBuffer.h"
+#include "CommandList.h"
+#include "FrameQueue.h"
+
+//gl objects of the sample, built on the render thread.
+//the main thread only records references to them, which needs no context
+struct Scene
 {
-  std::string VertexShader;
-  std::string FragmentShader;
+  const VertexArray* va;
+  const IndexBuffer* ib;
+  const Shader* shader;
 };
 
-static ShaderProgramSource ParseShader(const std::string& filepath){
-
-  enum class ShaderType
-  {
-    NONE = -1,
-    VERTEX = 0,
-    FRAGMENT = 1
-  };
-
-  ShaderType type = ShaderType::NONE;
-
-  std::ifstream stream (filepath);
-  std::string line;
-  std::stringstream ss[2];
-
-  while(getline(stream, line))
-  {
-    if(line.find("#shader") != std::string::npos)
-    {
-      if(line.find("vertex") != std::string::npos)
-        type = ShaderType::VERTEX; //set mode to vertex
-      else if(line.find("fragment") != std::string::npos)
-        type = ShaderType::FRAGMENT; //set mode to fragment
-    }
-    else
-      ss[(int)type] << line << '\n';
-  }
-  //returning the struct
-  ShaderProgramSource obj = { ss[0].str(), ss[1].str() };
-  return obj;
-}
-
-//strings are actual source code of the shaders
-
-static unsigned int CompileShader(unsigned int type, const std::string& source )
-{
-  unsigned int id = glCreateShader(type);
-  //returns the pointer to the string's starting
-  const char* src = source.c_str();
-  glShaderSource(id, 1, &src, nullptr);
-  glCompileShader(id);
-
-  int result;
-  glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-  //error handling
-  if(result==GL_FALSE)
-  {
-    int length;
-    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-    char* message = (char *)alloca(length * sizeof(char));
-    glGetShaderInfoLog(id, length, &length, message);
-    std::cout << "Failed to compile" << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << std::endl;
-    std::cout << message << std::endl;
-    glDeleteShader(id);
-    return 0;
-  }
-
-  return id;
-}
-
-static unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+//everything the main thread produces for one frame
+struct FramePacket
 {
-  unsigned int program = glCreateProgram();
-  unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-  unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
-
-  glAttachShader(program, vs);
-  glAttachShader(program, fs);
-
-  glLinkProgram(program);
-  glValidateProgram(program);
-
-  //glDeleteShader(vs);
-  // glDeleteShader(fs);
-  //glDeleteProgram(program);
-  return program;
-}
-
+  Vec4 color;
+  CommandList commands;
+};
 
-int main(void)
+//owns the GL context: builds the scene, then executes frames until running turns false
+static void RenderThread(GLFWwindow* window, FrameQueue<FramePacket>& frames,
+  std::atomic<const Scene*>& sceneOut, std::atomic<bool>& running)
 {
-  GLFWwindow* window;
-
-  /* Initialize the library */
-  if (!glfwInit())
-    return -1;
-
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-
-
-  /* Create a windowed mode window and it's OpenGL context */
-  window = glfwCreateWindow(640, 480, "Hello World", NULL, NULL);
-  if (!window)
-  {
-    glfwTerminate();
-    return -1;
-  }
   /* Make the window's context current */
   glfwMakeContextCurrent(window);
   //setting the frame-rate of your openGL context
@@ -125,6 +45,7 @@ int main(void)
 
   if (glewInit() != GLEW_OK)
     std::cout << "Error" << std::endl;
+  EnablePrimitiveRestart();
   {
     //building the buffer
     unsigned int buffer;
@@ -155,56 +76,121 @@ int main(void)
     int stride = sizeof(float) * 2; //amount of bytes for vertex
 
     
-    VertexBufferLayout layout;
-
-    layout.Push<float>(2);
-    va.AddBuffer(vb, layout);
+    //the layout is resolved at compile time, no allocation while setting up attributes
+    typedef Layout<Attr<float, 2>> PositionLayout;
+    static_assert(PositionLayout::Stride == sizeof(float) * 2, "unexpected vertex size");
+    va.AddBuffer(vb, PositionLayout());
     va.Bind();
 
-    ShaderProgramSource source = ParseShader("res/shaders/Basic.shader");
-    unsigned int shader = CreateShader(source.VertexShader, source.FragmentShader);
-    GLCALL(glUseProgram(shader));
-
+    ProgramBinaryCache programCache("res/shaders/cache");
+    Shader::SetBinaryCache(&programCache);
 
-    GLCALL(
-      int location = glGetUniformLocation(shader, "u_Color");
-    ASSERT(location != -1); //does not have incorrect values.
-    );
+    Shader shader("res/shaders/Basic.shader");
+    //edits to Basic.shader show up without restarting
+    ShaderWatcher watcher;
+    watcher.Watch(shader);
+    //std140 layout of the Frame block in Basic.shader
+    UniformBlockLayout frameLayout;
+    const unsigned int colorIndex = frameLayout.Push<Vec4>("u_Color");
+    shader.SetUniformBlockBinding("Frame", Renderer::FRAME_BINDING);
+    UniformBuffer uniforms(64 * 1024);
 
     //unbinding everything
-    GLCALL(glBindVertexArray(0));
-    GLCALL(glUseProgram(0));
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
-    GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    va.UnBind();
+    shader.Unbind();
+    vb.Unbind();
+    ib.Unbind();
 
 
-    //animating the colors
-    float r = 0.0f;
-    float increment = 0.05f;
+    Renderer renderer;
 
-    while (!glfwWindowShouldClose(window))
+    Scene scene = { &va, &ib, &shader };
+    sceneOut.store(&scene, std::memory_order_release);
+
+    while (FramePacket* frame = frames.BeginRead(running))
     {
-      //Render here
-      GLCALL(glClear(GL_COLOR_BUFFER_BIT));
+      //swaps in rebuilt shaders between frames
+      watcher.Update();
 
-      //before the draw call, you need to bind the data to buffer
-      GLCALL(glUseProgram(shader));
-      GLCALL(glUniform4f(location, r, 0.7f, 0.8f, 1.0f)); //can be set only after the shader is bound
+      //Render here
+      renderer.Clear();
 
-      va.Bind();
-      ib.Bind();
-      GLCALL(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));
+      //all blocks of the frame go up in one upload, draws only bind ranges of it
+      uniforms.Reset();
+      UniformBlockRange frameBlock = uniforms.Allocate(frameLayout);
+      frameLayout.Write(uniforms.GetData(frameBlock), colorIndex, frame->color);
+      uniforms.Upload();
+      uniforms.BindRange(Renderer::FRAME_BINDING, frameBlock);
 
-      if(r > 1.0f)
-        increment = -0.5f;
-      else if(r < 0.0f)
-        increment = 0.05f;
-      r += increment;
+      //draws are queued and issued sorted by state
+      frame->commands.Execute(renderer);
+      renderer.Flush(&uniforms);
+      //the packet is consumed, the main thread can fill it while we wait for vsync
+      frames.EndRead();
 
       GLCALL(glfwSwapBuffers(window));
-      GLCALL(glfwPollEvents());
     }
   }
+  glfwMakeContextCurrent(NULL);
+}
+
+int main(void)
+{
+  GLFWwindow* window;
+
+  /* Initialize the library */
+  if (!glfwInit())
+    return -1;
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+
+
+  /* Create a windowed mode window and it's OpenGL context */
+  window = glfwCreateWindow(640, 480, "Hello World", NULL, NULL);
+  if (!window)
+  {
+    glfwTerminate();
+    return -1;
+  }
+
+  //events have to be handled on the main thread, GL moves to its own thread so
+  //waiting for vsync doesn't hold up the simulation of the next frame
+  FrameQueue<FramePacket> frames;
+  std::atomic<const Scene*> scene(nullptr);
+  std::atomic<bool> running(true);
+  std::thread renderThread(RenderThread, window, std::ref(frames), std::ref(scene), std::ref(running));
+  while (!scene.load(std::memory_order_acquire))
+    std::this_thread::yield();
+  const Scene* objects = scene.load(std::memory_order_acquire);
+
+  //animating the colors
+  float r = 0.0f;
+  float increment = 0.05f;
+
+  while (!glfwWindowShouldClose(window))
+  {
+    glfwPollEvents();
+
+    if(r > 1.0f)
+      increment = -0.5f;
+    else if(r < 0.0f)
+      increment = 0.05f;
+    r += increment;
+
+    //waits while the render thread still has the previous frame queued
+    FramePacket* frame = frames.BeginWrite(running);
+    frame->color = Vec4{ r, 0.7f, 0.8f, 1.0f };
+    frame->commands.Reset(0);
+    DrawPacket packet = { objects->va, objects->ib, objects->shader, {0, 0}, {0, 0}, 0.0f, 0, 0, 0, 0, 0 };
+    frame->commands.Submit(packet);
+    frames.EndWrite();
+  }
+
+  running = false;
+  renderThread.join();
   GLCALL(glfwTerminate());
   return 0;
-}
\ No newline at end of file
+}